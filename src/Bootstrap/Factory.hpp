@@ -43,6 +43,7 @@
 #include "../Model/DeviceMap.hpp"
 #include "../Controller/Helper/Thread.hpp"
 #include "../Controller/Helper/RuleMover.hpp"
+#include "../lib/Mutex/Instrumented.hpp"
 #include "Application.hpp"
 
 class Bootstrap_Factory
@@ -66,10 +67,15 @@ class Bootstrap_Factory
 
 	public: std::shared_ptr<Bootstrap_Application_Object> applicationObject;
 
-	public: Bootstrap_Factory(std::shared_ptr<Bootstrap_Application_Object> applicationObject, std::shared_ptr<Logger> logger)
+	// if true, the created mutexes record lock statistics. They are logged on exit and on SIGUSR1
+	private: bool instrumentMutexes;
+	private: std::list<std::shared_ptr<Mutex_Instrumented>> instrumentedMutexes;
+
+	public: Bootstrap_Factory(std::shared_ptr<Bootstrap_Application_Object> applicationObject, std::shared_ptr<Logger> logger, bool instrumentMutexes = false)
 	{
 		this->applicationObject    = applicationObject;
 		this->logger               = logger;
+		this->instrumentMutexes    = instrumentMutexes;
 
 		this->regexEngine          = this->createRegexExgine();
 		this->threadHelper         = this->createThreadHelper();
@@ -89,6 +95,21 @@ class Bootstrap_Factory
 
 		this->bootstrap(this->regexEngine);
 		this->bootstrap(this->threadHelper);
+
+		// cancels the background tasks and waits for them before the application quits
+		this->applicationObject->addShutdownHandler(std::bind(std::mem_fn(&Controller_Helper_Thread::shutdown), this->threadHelper));
+
+		if (instrumentMutexes) {
+			this->applicationObject->addShutdownHandler(std::bind(std::mem_fn(&Bootstrap_Factory::dumpMutexStatistics), this));
+			this->connectMutexStatisticsSignal();
+		}
+	}
+
+	public: void dumpMutexStatistics()
+	{
+		for (auto mutex : this->instrumentedMutexes) {
+			mutex->dumpStatistics();
+		}
 	}
 
 	public: template <typename TController, typename TView> std::shared_ptr<TController> createController(std::shared_ptr<TView> view)
@@ -186,6 +207,7 @@ class Bootstrap_Factory
 	// external implementations
 	private: std::shared_ptr<Regex> createRegexExgine();
 	private: std::shared_ptr<Mutex> createMutex();
+	private: void connectMutexStatisticsSignal();
 	private: std::shared_ptr<Controller_Helper_Thread> createThreadHelper();
 };
 
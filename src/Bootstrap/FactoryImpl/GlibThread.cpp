@@ -28,7 +28,10 @@
 
 #include "../../Controller/Helper/GLibThread.hpp"
 #include "../../lib/Mutex/GLib.hpp"
+#include "../../lib/Mutex/Instrumented.hpp"
 #include "../Factory.hpp"
+#include <csignal>
+#include <glib-unix.h>
 
 std::shared_ptr<Controller_Helper_Thread> Bootstrap_Factory::createThreadHelper()
 {
@@ -39,5 +42,23 @@ std::shared_ptr<Controller_Helper_Thread> Bootstrap_Factory::createThreadHelper(
 
 std::shared_ptr<Mutex> Bootstrap_Factory::createMutex()
 {
-	return std::make_shared<Mutex_GLib>();
+	auto mutex = std::make_shared<Mutex_GLib>();
+	if (!this->instrumentMutexes) {
+		return mutex;
+	}
+	auto instrumentedMutex = std::make_shared<Mutex_Instrumented>(mutex, "mutex #" + std::to_string(this->instrumentedMutexes.size() + 1));
+	this->instrumentedMutexes.push_back(instrumentedMutex);
+	return instrumentedMutex;
+}
+
+static gboolean dumpMutexStatisticsCallback(gpointer factory)
+{
+	static_cast<Bootstrap_Factory*>(factory)->dumpMutexStatistics();
+	return G_SOURCE_CONTINUE;
+}
+
+// dumps the lock statistics on demand: kill -USR1 <pid>
+void Bootstrap_Factory::connectMutexStatisticsSignal()
+{
+	g_unix_signal_add(SIGUSR1, &dumpMutexStatisticsCallback, this);
 }
@@ -241,7 +241,7 @@ class EntryEditController :
 					script = this->createCustomScript();
 				}
 				assert(script != nullptr);
-				script->entries().push_back(std::make_shared<Model_Entry>("new", "", "", type));
+				script->addEntry(std::make_shared<Model_Entry>("new", "", "", type));
 	
 				auto newRule = std::make_shared<Model_Rule>(script->entries().back(), true, script);
 	
@@ -268,7 +268,7 @@ class EntryEditController :
 						script = this->createCustomScript();
 					}
 					assert(script != nullptr);
-					script->entries().push_back(std::make_shared<Model_Entry>(*rule->dataSource));
+					script->addEntry(std::make_shared<Model_Entry>(*rule->dataSource));
 	
 					auto ruleCopy = rule->clone();
 					rule->setVisibility(false);
@@ -294,10 +294,10 @@ class EntryEditController :
 			}
 	
 			std::string newCode = this->view->getSourcecode();
-			rule->dataSource->content = newCode;
+			rule->dataSource->setContent(newCode);
 			rule->dataSource->isModified = true;
-			rule->dataSource->type = type;
-			rule->dataSource->name = this->view->getName();
+			rule->dataSource->setType(type);
+			rule->dataSource->setName(this->view->getName());
 			rule->outputName = this->view->getName();
 			rule->type = ruleType;
 	
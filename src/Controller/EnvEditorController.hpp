@@ -99,6 +99,7 @@ class EnvEditorController :
 		try {
 			try {
 				this->mountTable->getEntryRefByMountpoint(PARTCHOOSER_MOUNTPOINT + submountpoint).mount();
+				this->env->clearCommandCache();
 			} catch (MountException const& e){
 				this->view->showErrorMessage(View_EnvEditor::SUB_MOUNT_FAILED);
 				this->view->setSubmountpointSelectionState(submountpoint, false);
@@ -119,6 +120,7 @@ class EnvEditorController :
 		try {
 			try {
 				this->mountTable->getEntryRefByMountpoint(PARTCHOOSER_MOUNTPOINT + submountpoint).umount();
+				this->env->clearCommandCache();
 			} catch (UMountException const& e){
 				this->view->showErrorMessage(View_EnvEditor::SUB_UMOUNT_FAILED);
 				this->view->setSubmountpointSelectionState(submountpoint, true);
@@ -155,6 +157,7 @@ class EnvEditorController :
 	{
 		this->logActionBegin("switch-partition");
 		try {
+			this->env->clearCommandCache(); // every partition is mounted at PARTCHOOSER_MOUNTPOINT
 			if (this->mountTable->getEntryByMountpoint(PARTCHOOSER_MOUNTPOINT).isMounted) {
 				this->mountTable->umountAll(PARTCHOOSER_MOUNTPOINT);
 				this->mountTable->clear(PARTCHOOSER_MOUNTPOINT);
@@ -193,6 +196,7 @@ class EnvEditorController :
 	{
 		this->logActionBegin("switch-bootloader-type");
 		try {
+			this->env->clearCommandCache();
 			this->env->init(newTypeIndex == 0 ? Model_Env::GRUB_MODE : Model_Env::BURG_MODE, this->env->cfg_dir_prefix);
 			this->showAction();
 		} catch (Exception const& e) {
@@ -224,6 +228,7 @@ class EnvEditorController :
 				this->env->save();
 			}
 			this->deviceMap->clearCache();
+			this->env->clearCommandCache();
 			this->applicationObject->onEnvChange.exec(isBurgMode);
 		} catch (Exception const& e) {
 			this->applicationObject->onError.exec(e);
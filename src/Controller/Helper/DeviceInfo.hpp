@@ -45,11 +45,10 @@ class Controller_Helper_DeviceInfo
 			options = contentParserFactory.create(menuEntryData)->getOptions();
 			if (options.find("partition_uuid") != options.end()) {
 				// add device path
-				for (auto& item : deviceDataList) {
-					if (item.second.find("UUID") != item.second.end() && item.second.at("UUID") == options["partition_uuid"]) {
-						options["_deviceName"] = item.first;
-						break;
-					}
+				try {
+					options["_deviceName"] = deviceDataList.getDeviceByUuid(options["partition_uuid"]);
+				} catch (ItemNotFoundException const& e) {
+					// unknown partition
 				}
 			}
 		} catch (ParserNotFoundException const& e) {
@@ -32,23 +32,112 @@
 
 #include <functional>
 #include <queue>
+#include <map>
+#include <list>
 
 #include <glibmm/thread.h>
 #include <glibmm/dispatcher.h>
 
 #include <glibmm.h>
 
+class Controller_Helper_GLibThread_Task : public Controller_Helper_Thread_Task
+{
+	private: std::function<void (std::shared_ptr<CancellationToken> cancellationToken)> function;
+	private: std::shared_ptr<CancellationToken> cancellationToken;
+	private: Glib::Threads::Mutex mutex;
+	private: Glib::Threads::Cond finishedCondition;
+	private: bool started, finished;
+
+	public: Controller_Helper_Thread::Priority priority;
+
+	public: Controller_Helper_GLibThread_Task(
+		std::function<void (std::shared_ptr<CancellationToken> cancellationToken)> function,
+		Controller_Helper_Thread::Priority priority
+	) : function(function), priority(priority), cancellationToken(std::make_shared<CancellationToken>()), started(false), finished(false)
+	{}
+
+	public: std::shared_ptr<CancellationToken> getCancellationToken()
+	{
+		return this->cancellationToken;
+	}
+
+	public: void cancel()
+	{
+		this->cancellationToken->cancel();
+	}
+
+	public: bool isFinished()
+	{
+		Glib::Threads::Mutex::Lock lock(this->mutex);
+		return this->finished;
+	}
+
+	public: void join()
+	{
+		if (this->run()) {
+			return;
+		}
+		Glib::Threads::Mutex::Lock lock(this->mutex);
+		while (!this->finished) {
+			this->finishedCondition.wait(this->mutex);
+		}
+	}
+
+	// runs the task in the calling thread - returns false if it has already been started by another thread
+	public: bool run()
+	{
+		Glib::Threads::Mutex::Lock lock(this->mutex);
+		if (this->started) {
+			return false;
+		}
+		this->started = true;
+		lock.release();
+
+		this->function(this->cancellationToken);
+		this->function = nullptr; // release the bound objects
+
+		lock.acquire();
+		this->finished = true;
+		this->finishedCondition.broadcast();
+		return true;
+	}
+};
+
 class Controller_Helper_GLibThread : public Controller_Helper_Thread
 {
 	private: std::queue<std::function<void ()>> dispatchQueue;
 	private: Glib::Dispatcher dispatcher; // the new general dispatcher
 	private: Glib::Threads::Mutex mutex;
 
+	private: struct CoalescedCall {
+		std::function<void ()> function; // newest function of the channel
+		bool scheduled; // true if a run has been dispatched but not executed yet
+		gint64 lastRun; // monotonic time in µs
+
+		CoalescedCall() : scheduled(false), lastRun(0) {}
+	};
+	private: std::map<std::string, CoalescedCall> coalescedCalls;
+
+	// the worker threads are started when the first task is added
+	private: static const int workerCount = 4;
+	private: std::list<Glib::Threads::Thread*> workers;
+	private: std::list<std::shared_ptr<Controller_Helper_GLibThread_Task>> taskQueue; // sorted by priority
+	private: std::list<std::shared_ptr<Controller_Helper_GLibThread_Task>> activeTasks; // queued and running tasks
+	private: Glib::Threads::Mutex taskMutex;
+	private: Glib::Threads::Cond taskCondition;
+	private: bool shutdownRequested;
+
 	public: Controller_Helper_GLibThread()
+		: shutdownRequested(false)
 	{
 		this->dispatcher.connect(sigc::mem_fun(this, &Controller_Helper_GLibThread::dispatcherCallback));
 	}
 
+	public: ~Controller_Helper_GLibThread()
+	{
+		this->shutdown();
+	}
+
 	public: void runDispatched(std::function<void ()> function)
 	{
 		Glib::Threads::Mutex::Lock lock(this->mutex);
@@ -58,14 +147,120 @@ class Controller_Helper_GLibThread : public Controller_Helper_Thread
 		this->dispatcher();
 	}
 
+	public: void runDispatchedCoalesced(std::string const& channel, std::function<void ()> function, int minIntervalInMilliSec)
+	{
+		Glib::Threads::Mutex::Lock lock(this->mutex);
+		CoalescedCall& call = this->coalescedCalls[channel];
+		call.function = function;
+		if (call.scheduled) {
+			return; // the pending run picks up the new function
+		}
+		call.scheduled = true;
+		lock.release();
+
+		this->runDispatched(std::bind(std::mem_fn(&Controller_Helper_GLibThread::runCoalescedCall), this, channel, minIntervalInMilliSec));
+	}
+
 	public: void runDelayed(std::function<void ()> function, int delayInMilliSec)
 	{
 		Glib::signal_timeout().connect_once(function, delayInMilliSec);
 	}
 
-	public: void runAsThread(std::function<void ()> function)
+	public: std::shared_ptr<Controller_Helper_Thread_Task> runAsThread(
+		std::function<void (std::shared_ptr<CancellationToken> cancellationToken)> function,
+		Priority priority = PRIORITY_NORMAL
+	) {
+		auto task = std::make_shared<Controller_Helper_GLibThread_Task>(function, priority);
+
+		Glib::Threads::Mutex::Lock lock(this->taskMutex);
+		if (this->shutdownRequested) {
+			this->log("thread pool is shut down - task is not executed", Logger::ERROR);
+			task->cancel();
+			return task;
+		}
+		if (this->workers.size() == 0) {
+			for (int i = 0; i < Controller_Helper_GLibThread::workerCount; i++) {
+				this->workers.push_back(Glib::Threads::Thread::create(sigc::mem_fun(this, &Controller_Helper_GLibThread::workerLoop)));
+			}
+		}
+		auto insertPosition = this->taskQueue.begin();
+		while (insertPosition != this->taskQueue.end() && (*insertPosition)->priority >= priority) {
+			insertPosition++;
+		}
+		this->taskQueue.insert(insertPosition, task);
+		this->activeTasks.push_back(task);
+		this->taskCondition.signal();
+
+		return task;
+	}
+
+	public: void shutdown()
 	{
-		Glib::Thread::create(function, false);
+		Glib::Threads::Mutex::Lock lock(this->taskMutex);
+		this->shutdownRequested = true;
+		for (auto task : this->activeTasks) {
+			task->cancel();
+		}
+		this->taskCondition.broadcast();
+
+		// the workers finish the queued tasks - they get cancelled tokens
+		std::list<Glib::Threads::Thread*> workers = this->workers;
+		for (auto worker : workers) {
+			if (worker == Glib::Threads::Thread::self()) {
+				this->log("thread pool shutdown requested by a worker - the workers are joined later", Logger::INFO);
+				return;
+			}
+		}
+		this->workers.clear();
+		lock.release();
+
+		for (auto worker : workers) {
+			worker->join();
+		}
+	}
+
+	private: void workerLoop()
+	{
+		Glib::Threads::Mutex::Lock lock(this->taskMutex);
+		while (true) {
+			while (this->taskQueue.size() == 0 && !this->shutdownRequested) {
+				this->taskCondition.wait(this->taskMutex);
+			}
+			if (this->taskQueue.size() == 0) {
+				return;
+			}
+			auto task = this->taskQueue.front();
+			this->taskQueue.pop_front();
+			lock.release();
+
+			task->run(); // does nothing if the task has been run by join()
+
+			lock.acquire();
+			this->activeTasks.remove(task);
+		}
+	}
+
+	// executed in the main thread
+	private: void runCoalescedCall(std::string const& channel, int minIntervalInMilliSec)
+	{
+		Glib::Threads::Mutex::Lock lock(this->mutex);
+		CoalescedCall& call = this->coalescedCalls[channel];
+		gint64 now = g_get_monotonic_time();
+		gint64 remainingTime = call.lastRun + gint64(minIntervalInMilliSec) * 1000 - now;
+		if (call.lastRun != 0 && remainingTime > 0) {
+			lock.release();
+			this->runDelayed(
+				std::bind(std::mem_fn(&Controller_Helper_GLibThread::runCoalescedCall), this, channel, minIntervalInMilliSec),
+				remainingTime / 1000 + 1
+			);
+			return;
+		}
+		auto func = call.function;
+		call.scheduled = false;
+		call.lastRun = now;
+		lock.release();
+
+		func();
 	}
 
 	private: void dispatcherCallback()
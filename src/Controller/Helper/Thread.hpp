@@ -29,14 +29,44 @@
 #ifndef HELPER_THREAD_H_INCLUDED
 #define HELPER_THREAD_H_INCLUDED
 #include "../../lib/Trait/LoggerAware.hpp"
+#include "../../lib/CancellationToken.hpp"
 #include <functional>
+#include <memory>
+#include <string>
+
+// handle of a task started by Controller_Helper_Thread::runAsThread
+class Controller_Helper_Thread_Task
+{
+	public: virtual inline ~Controller_Helper_Thread_Task() {};
+	public: virtual std::shared_ptr<CancellationToken> getCancellationToken() = 0;
+	// requests the task to stop - it's up to the task to check its token
+	public: virtual void cancel() = 0;
+	public: virtual bool isFinished() = 0;
+	// waits until the task is finished. A task which hasn't been started yet is run by the calling thread.
+	public: virtual void join() = 0;
+};
 
 class Controller_Helper_Thread : public Trait_LoggerAware
 {
+	public: enum Priority {
+		PRIORITY_LOW,
+		PRIORITY_NORMAL,
+		PRIORITY_HIGH
+	};
+
 	public: virtual inline ~Controller_Helper_Thread() {};
 	public: virtual void runDispatched(std::function<void ()> function) = 0;
+	// like runDispatched, but calls of the same channel are coalesced: if a call is still pending, only the newest
+	// function is kept. The functions of a channel are run at most once per interval
+	public: virtual void runDispatchedCoalesced(std::string const& channel, std::function<void ()> function, int minIntervalInMilliSec) = 0;
 	public: virtual void runDelayed(std::function<void ()> function, int delayInMilliSec) = 0;
-	public: virtual void runAsThread(std::function<void ()> function) = 0;
+	// runs the function in a background thread. It gets the cancellation token of the task as parameter
+	public: virtual std::shared_ptr<Controller_Helper_Thread_Task> runAsThread(
+		std::function<void (std::shared_ptr<CancellationToken> cancellationToken)> function,
+		Priority priority = PRIORITY_NORMAL
+	) = 0;
+	// cancels all tasks and waits until they are finished
+	public: virtual void shutdown() = 0;
 };
 
 class Controller_Helper_Thread_Connection
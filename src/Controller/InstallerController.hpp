@@ -98,7 +98,8 @@ class InstallerController :
 	{
 		this->logActionBegin("install-grub");
 		try {
-			this->threadHelper->runAsThread(std::bind(std::mem_fn(&InstallerController::installGrubThreadedAction), this, device));
+			// not cancellable - stopping in the middle would leave a broken boot loader
+			this->threadHelper->runAsThread(std::bind(std::mem_fn(&InstallerController::installGrubThreadedAction), this, device), Controller_Helper_Thread::PRIORITY_HIGH);
 		} catch (Exception const& e) {
 			this->applicationObject->onError.exec(e);
 		}
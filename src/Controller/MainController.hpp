@@ -38,12 +38,14 @@
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <chrono>
 #include "../config.hpp"
 
 #include "../Model/Env.hpp"
 
 #include "../Model/ListCfg.hpp"
 #include "../Model/DeviceDataList.hpp"
+#include "../lib/ChildProcess.hpp"
 #include "../lib/ContentParserFactory.hpp"
 
 #include "Common/ControllerAbstract.hpp"
@@ -81,7 +83,15 @@ class MainController :
 
 	private: bool config_has_been_different_on_startup_but_unsaved;
 	private: bool is_loading;
+	private: std::shared_ptr<Controller_Helper_Thread_Task> loadTask;
+	private: std::shared_ptr<Model_ListCfgSnapshot const> listedSnapshot; // the snapshot shown by the list
 	private: CmdExecException thrownException; //to be used from the die() function
+	private: std::list<Model_Env::Mode> availableModes; // detected while starting up
+	private: std::chrono::steady_clock::time_point startupBegin;
+	private: bool startupTimeLogged; // true if the time to the first interaction has been logged
+
+	// minimum interval between two updates of the load/save progress (about once per frame)
+	private: static const int progressSyncInterval = 16;
 
 	public: void setSettingsBuffer(std::shared_ptr<Model_SettingsManagerData> settings)
 	{
@@ -176,6 +186,8 @@ class MainController :
 	//init functions
 	public: void init()
 	{
+		using namespace std::placeholders;
+
 		if ( !grublistCfg
 			or !view
 			or !settings
@@ -194,41 +206,32 @@ class MainController :
 
 		savedListCfg->verbose = false;
 
-		this->log("reading partition info…", Logger::EVENT);
-		FILE* blkidProc = popen("blkid", "r");
-		if (blkidProc){
-			deviceDataList->clear();
-			deviceDataList->loadData(blkidProc);
-			pclose(blkidProc);
-		}
-
-		mountTable->loadData("");
-		mountTable->loadData(PARTCHOOSER_MOUNTPOINT);
-
-
-		this->env->rootDeviceName = mountTable->getEntryByMountpoint("").device;
+		// the window is shown while the system is inspected. The probes are independent
+		// of each other, the startup is finished when the mount table and the modes are known
+		this->startupBegin = std::chrono::steady_clock::now();
+		this->startupTimeLogged = false;
+		this->view->setLockState(~0);
+		this->view->show();
+		this->view->setStatusText(gettext("Reading system information"));
 
 		this->applicationObject->onInit.exec();
 
-		//dir_prefix may be set by partition chooser (if not, the root partition is used)
-
-		this->log("Finding out if this is a live CD", Logger::EVENT);
-		//aufs is the virtual root fileSystem used by live cds
-		if (mountTable->getEntryByMountpoint("").isLiveCdFs() && env->cfg_dir_prefix == ""){
-			this->log("is live CD", Logger::INFO);
-			this->env->init(Model_Env::GRUB_MODE, "");
-			this->showEnvEditorAction();
-		} else {
-			this->log("running on an installed system", Logger::INFO);
-			std::list<Model_Env::Mode> modes = this->env->getAvailableModes();
-			if (modes.size() == 2) {
-				this->view->showBurgSwitcher();
-			} else if (modes.size() == 1) {
-				this->init(modes.front());
-			} else if (modes.size() == 0) {
-				this->showEnvEditorAction();
-			}
-		}
+		this->threadHelper->runAsThread(
+			std::bind(std::mem_fn(&MainController::loadDeviceDataThreadedAction), this, _1),
+			Controller_Helper_Thread::PRIORITY_LOW
+		);
+		auto mountTableTask = this->threadHelper->runAsThread(
+			std::bind(std::mem_fn(&MainController::loadMountTableThreadedAction), this, _1),
+			Controller_Helper_Thread::PRIORITY_HIGH
+		);
+		auto modeDetectionTask = this->threadHelper->runAsThread(
+			std::bind(std::mem_fn(&MainController::detectModesThreadedAction), this, _1),
+			Controller_Helper_Thread::PRIORITY_HIGH
+		);
+		this->threadHelper->runAsThread(
+			std::bind(std::mem_fn(&MainController::finishStartupThreadedAction), this, mountTableTask, modeDetectionTask, _1),
+			Controller_Helper_Thread::PRIORITY_HIGH
+		);
 	}
 
 	public: void init(Model_Env::Mode mode, bool initEnv = true)
@@ -250,7 +253,22 @@ class MainController :
 		}
 
 		this->log("loading configuration", Logger::IMPORTANT_EVENT);
-		this->threadHelper->runAsThread(std::bind(std::mem_fn(&MainController::loadThreadedAction), this, false));
+		this->startLoad(false);
+	}
+
+	// a running load is cancelled - the new one starts when it has finished
+	private: void startLoad(bool preserveConfig)
+	{
+		using namespace std::placeholders;
+
+		auto previousTask = this->loadTask;
+		if (previousTask && !previousTask->isFinished()) {
+			this->log("cancelling the running load", Logger::INFO);
+			previousTask->cancel();
+		}
+		this->loadTask = this->threadHelper->runAsThread(
+			std::bind(std::mem_fn(&MainController::loadThreadedAction), this, preserveConfig, previousTask, _1)
+		);
 	}
 
 	public: void initAction()
@@ -264,6 +282,39 @@ class MainController :
 		this->logActionEnd();
 	}
 
+	public: void finishStartupAction()
+	{
+		this->logActionBegin("finish-startup");
+		try {
+			this->log("system information read after " + this->getStartupTime() + " ms", Logger::INFO);
+			this->view->setStatusText("");
+			this->env->rootDeviceName = mountTable->getEntryByMountpoint("").device;
+
+			//dir_prefix may be set by partition chooser (if not, the root partition is used)
+
+			this->log("Finding out if this is a live CD", Logger::EVENT);
+			//aufs is the virtual root fileSystem used by live cds
+			if (mountTable->getEntryByMountpoint("").isLiveCdFs() && env->cfg_dir_prefix == ""){
+				this->log("is live CD", Logger::INFO);
+				this->env->init(Model_Env::GRUB_MODE, "");
+				this->showEnvEditorAction();
+			} else {
+				this->log("running on an installed system", Logger::INFO);
+				if (this->availableModes.size() == 2) {
+					this->view->hide(); // closing the switcher quits the application
+					this->view->showBurgSwitcher();
+				} else if (this->availableModes.size() == 1) {
+					this->init(this->availableModes.front());
+				} else if (this->availableModes.size() == 0) {
+					this->showEnvEditorAction();
+				}
+			}
+		} catch (Exception const& e) {
+			this->applicationObject->onError.exec(e);
+		}
+		this->logActionEnd();
+	}
+
 	public: void reInitAction(bool burgMode)
 	{
 		this->logActionBegin("re-init");
@@ -317,17 +368,95 @@ class MainController :
 			this->applicationObject->onSettingModelChange.exec();
 			this->view->hideReloadRecommendation();
 			this->view->setLockState(1|4|8);
-			this->threadHelper->runAsThread(std::bind(std::mem_fn(&MainController::loadThreadedAction), this, true));
+			this->startLoad(true);
 		} catch (Exception const& e) {
 			this->applicationObject->onError.exec(e);
 		}
 		this->logActionEnd();
 	}
 
-	public: void loadThreadedAction(bool preserveConfig)
+	public: void loadDeviceDataThreadedAction(std::shared_ptr<CancellationToken> cancellationToken)
 	{
+		this->logActionBeginThreaded("load-device-data-threaded");
+		try {
+			this->log("reading partition info…", Logger::EVENT);
+			auto deviceDataList = std::make_shared<Model_DeviceDataList>();
+			if (!deviceDataList->loadFromSystem()) {
+				this->log("udev data not found, running blkid", Logger::INFO);
+				ChildProcess blkid;
+				FILE* blkidProc = blkid.open("blkid", cancellationToken);
+				if (blkidProc) {
+					deviceDataList->loadData(blkidProc);
+					blkid.close();
+				}
+			}
+			if (!cancellationToken->isCancelled()) {
+				this->threadHelper->runDispatched([this, deviceDataList] {
+					this->deviceDataList->assign(*deviceDataList);
+					if (this->listedSnapshot) {
+						this->listedSnapshot = nullptr; // the device names are shown in the list
+						this->updateList();
+					}
+				});
+			}
+		} catch (Exception const& e) {
+			this->applicationObject->onThreadError.exec(e);
+		}
+		this->logActionEndThreaded();
+	}
+
+	public: void loadMountTableThreadedAction(std::shared_ptr<CancellationToken> cancellationToken)
+	{
+		this->logActionBeginThreaded("load-mount-table-threaded");
+		try {
+			this->mountTable->loadData("");
+			this->mountTable->loadData(PARTCHOOSER_MOUNTPOINT);
+		} catch (Exception const& e) {
+			this->applicationObject->onThreadError.exec(e);
+		}
+		this->logActionEndThreaded();
+	}
+
+	public: void detectModesThreadedAction(std::shared_ptr<CancellationToken> cancellationToken)
+	{
+		this->logActionBeginThreaded("detect-modes-threaded");
+		try {
+			this->availableModes = this->env->getAvailableModes();
+		} catch (Exception const& e) {
+			this->applicationObject->onThreadError.exec(e);
+		}
+		this->logActionEndThreaded();
+	}
+
+	// waits for the probes required to decide how to continue
+	public: void finishStartupThreadedAction(
+		std::shared_ptr<Controller_Helper_Thread_Task> mountTableTask,
+		std::shared_ptr<Controller_Helper_Thread_Task> modeDetectionTask,
+		std::shared_ptr<CancellationToken> cancellationToken
+	) {
+		this->logActionBeginThreaded("finish-startup-threaded");
+		try {
+			mountTableTask->join();
+			modeDetectionTask->join();
+			if (!cancellationToken->isCancelled()) {
+				this->threadHelper->runDispatched(std::bind(std::mem_fn(&MainController::finishStartupAction), this));
+			}
+		} catch (Exception const& e) {
+			this->applicationObject->onThreadError.exec(e);
+		}
+		this->logActionEndThreaded();
+	}
+
+	public: void loadThreadedAction(
+		bool preserveConfig,
+		std::shared_ptr<Controller_Helper_Thread_Task> previousTask,
+		std::shared_ptr<CancellationToken> cancellationToken
+	) {
 		this->logActionBeginThreaded("load-threaded");
 		try {
+			if (previousTask) {
+				previousTask->join();
+			}
 			if (!is_loading){ //allow only one load thread at the same time!
 				this->log(std::string("loading - preserveConfig: ") + (preserveConfig ? "yes" : "no"), Logger::IMPORTANT_EVENT);
 				is_loading = true;
@@ -356,7 +485,7 @@ class MainController :
 
 				try {
 					this->log("loading grub list", Logger::IMPORTANT_EVENT);
-					this->grublistCfg->load(preserveConfig);
+					this->grublistCfg->load(preserveConfig, cancellationToken);
 					this->log("grub list completely loaded", Logger::IMPORTANT_EVENT);
 				} catch (CmdExecException const& e){
 					this->log("error while loading the grub list", Logger::ERROR);
@@ -365,7 +494,7 @@ class MainController :
 					return; //cancel
 				}
 
-				if (!preserveConfig){
+				if (!preserveConfig && !cancellationToken->isCancelled()){
 					this->log("loading saved grub list", Logger::IMPORTANT_EVENT);
 					if (this->savedListCfg->loadStaticCfg()) {
 						this->config_has_been_different_on_startup_but_unsaved = !this->grublistCfg->compare(*this->savedListCfg);
@@ -400,7 +529,8 @@ class MainController :
 
 			this->view->setLockState(1|4|8);
 			this->env->activeThreadCount++; //not in save_thead() to be faster set
-			this->threadHelper->runAsThread(std::bind(std::mem_fn(&MainController::saveThreadedAction), this));
+			// not cancellable - stopping in the middle would leave a broken configuration
+			this->threadHelper->runAsThread(std::bind(std::mem_fn(&MainController::saveThreadedAction), this), Controller_Helper_Thread::PRIORITY_HIGH);
 		} catch (Exception const& e) {
 			this->applicationObject->onError.exec(e);
 		}
@@ -442,10 +572,17 @@ class MainController :
 		this->logActionEndThreaded();
 	}
 
+	// milliseconds since the start of init()
+	private: std::string getStartupTime() const
+	{
+		return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->startupBegin).count());
+	}
+
 	public: MainController() :
 		Controller_Common_ControllerAbstract("main"),
 		config_has_been_different_on_startup_but_unsaved(false),
 		is_loading(false),
+		startupTimeLogged(true),
 		currentContentParser(NULL),
 		thrownException("")
 	{
@@ -466,7 +603,7 @@ class MainController :
 			}
 
 			if (rule->dataSource && this->grublistCfg->repository.getScriptByEntry(rule->dataSource)->isCustomScript) {
-				rule->dataSource->name = newName;
+				rule->dataSource->setName(newName);
 			}
 
 			this->applicationObject->onListModelChange.exec();
@@ -540,22 +677,61 @@ class MainController :
 
 	public: void updateList()
 	{
-		this->view->clear();
-
-		for (auto& proxy : this->grublistCfg->proxies){
-			std::string name = proxy->getScriptName();
-			if ((name != "header" && name != "debian_theme" && name != "grub-customizer_menu_color_helper") || proxy->isModified()) {
-				View_Model_ListItem<Rule, Proxy> listItem;
-				listItem.name = name;
-				listItem.scriptPtr = proxy.get();
-				listItem.is_submenu = true;
-				listItem.defaultName = name;
-				listItem.isVisible = true;
-				this->view->appendEntry(listItem);
-				for (auto& rule : proxy->rules){
-					this->appendRuleToView(rule);
+		auto snapshot = this->grublistCfg->getSnapshot();
+		if (snapshot == this->listedSnapshot) {
+			return; // nothing published since the last update
+		}
+		this->listedSnapshot = snapshot;
+
+		this->view->beginListUpdate();
+
+		try {
+			for (auto& proxy : snapshot->proxies){
+				if (!this->isHiddenScript(proxy.scriptName) || proxy.isModified) {
+					View_Model_ListItem<Rule, Proxy> listItem;
+					listItem.name = proxy.scriptName;
+					listItem.scriptPtr = proxy.proxy.get();
+					listItem.is_submenu = true;
+					listItem.defaultName = proxy.scriptName;
+					listItem.isVisible = true;
+					this->view->appendEntry(listItem);
+					for (auto& rule : proxy.rules){
+						this->appendRuleToView(*rule, proxy);
+					}
 				}
 			}
+		} catch (Exception const& e) {
+			this->view->endListUpdate(); // don't leave the view in update mode
+			throw;
+		}
+
+		this->view->endListUpdate();
+	}
+
+	// refreshes the rules of the proxies changed by an incremental load, the other items of the list are kept
+	public: void updateReloadedProxies()
+	{
+		if (!this->view->getOptions().at(VIEW_GROUP_BY_SCRIPT)) {
+			this->updateList(); // entries aren't grouped by proxy
+			return;
+		}
+		for (auto& proxy : this->grublistCfg->reloadedProxies) {
+			if (this->isHiddenScript(proxy->getScriptName())) {
+				this->updateList(); // listing depends on the modification state of the proxy
+				return;
+			}
+		}
+		auto snapshot = this->grublistCfg->getSnapshot();
+		this->listedSnapshot = snapshot;
+		for (auto& proxy : snapshot->proxies) {
+			auto& reloadedProxies = this->grublistCfg->reloadedProxies;
+			if (std::find(reloadedProxies.begin(), reloadedProxies.end(), proxy.proxy) == reloadedProxies.end()) {
+				continue;
+			}
+			this->view->clearScript(proxy.proxy.get());
+			for (auto& rule : proxy.rules){
+				this->appendRuleToView(*rule, proxy);
+			}
 		}
 	}
 
@@ -564,7 +740,7 @@ class MainController :
 		bool placeholdersVisible = this->view->getOptions().at(VIEW_SHOW_PLACEHOLDERS);
 		bool hiddenEntriesVisible = this->view->getOptions().at(VIEW_SHOW_HIDDEN_ENTRIES);
 		this->view->setTrashPaneVisibility(
-			this->grublistCfg->getRemovedEntries(NULL, !placeholdersVisible).size() >= 1 && !hiddenEntriesVisible
+			this->grublistCfg->getSnapshot()->getRemovedEntries(!placeholdersVisible).size() >= 1 && !hiddenEntriesVisible
 		);
 	}
 
@@ -581,7 +757,9 @@ class MainController :
 			if (dlgResponse != 0){
 				if (this->env->activeThreadCount != 0){
 					this->env->quit_requested = true;
-					this->grublistCfg->cancelThreads();
+					if (this->loadTask) {
+						this->loadTask->cancel();
+					}
 				}
 				else {
 					this->applicationObject->shutdown();
@@ -780,7 +958,7 @@ class MainController :
 	{
 		this->logActionBeginThreaded("sync-load-state-threaded");
 		try {
-			this->threadHelper->runDispatched(std::bind(std::mem_fn(&MainController::syncLoadStateAction), this));
+			this->threadHelper->runDispatchedCoalesced("sync-load-state", std::bind(std::mem_fn(&MainController::syncLoadStateAction), this), progressSyncInterval);
 		} catch (Exception const& e) {
 			this->applicationObject->onThreadError.exec(e);
 		}
@@ -791,7 +969,7 @@ class MainController :
 	{
 		this->logActionBeginThreaded("sync-save-state-threaded");
 		try {
-			this->threadHelper->runDispatched(std::bind(std::mem_fn(&MainController::syncSaveStateAction), this));
+			this->threadHelper->runDispatchedCoalesced("sync-save-state", std::bind(std::mem_fn(&MainController::syncSaveStateAction), this), progressSyncInterval);
 		} catch (Exception const& e) {
 			this->applicationObject->onThreadError.exec(e);
 		}
@@ -849,21 +1027,30 @@ class MainController :
 				this->view->setStatusText("");
 			}
 
+			bool fullUpdateRequired = !this->grublistCfg->loadedIncrementally;
 			if (progress == 1 && this->grublistCfg->hasScriptUpdates()) {
 				this->grublistCfg->applyScriptUpdates();
 				this->env->modificationsUnsaved = true;
 				this->view->showScriptUpdateInfo();
+				fullUpdateRequired = true;
 			}
 
-			//if grubConfig is locked, it will be cancelled as early as possible
-			if (this->grublistCfg->lock_if_free()) {
+			// reads the latest snapshot - doesn't wait for the load thread
+			if (fullUpdateRequired) {
 				this->updateList();
-				this->grublistCfg->unlock();
+			} else if (progress == 1) {
+				// the rules of an incremental load are updated at the end
+				this->updateReloadedProxies();
 			}
 
 			if (progress == 1){
 				this->view->setLockState(0);
 
+				if (!this->startupTimeLogged) {
+					this->log("startup: interactive after " + this->getStartupTime() + " ms", Logger::IMPORTANT_EVENT);
+					this->startupTimeLogged = true;
+				}
+
 				this->applicationObject->onListModelChange.exec();
 			}
 			this->log("MainControllerImpl::syncListView_load completed", Logger::INFO);
@@ -988,6 +1175,7 @@ class MainController :
 			} catch (FileSaveException e) {
 				this->log("option saving failed", Logger::ERROR);
 			}
+			this->listedSnapshot = nullptr; // the list has to be rebuilt using the new options
 			this->applicationObject->onListModelChange.exec();
 		} catch (Exception const& e) {
 			this->applicationObject->onError.exec(e);
@@ -1020,54 +1208,59 @@ class MainController :
 		this->logActionEnd();
 	}
 
-	private: void appendRuleToView(std::shared_ptr<Model_Rule> rule, std::shared_ptr<Model_Rule> parentRule = nullptr)
+	// scripts which are only listed if modified
+	private: bool isHiddenScript(std::string const& name) const
 	{
-		bool is_other_entries_ph = rule->type == Model_Rule::OTHER_ENTRIES_PLACEHOLDER;
-		bool is_plaintext = rule->dataSource && rule->dataSource->type == Model_Entry::PLAINTEXT;
-		bool is_submenu = rule->type == Model_Rule::SUBMENU;
-
-		if (rule->dataSource || is_submenu){
-			std::string name = this->entryNameMapper->map(rule->dataSource, rule->outputName, true);
+		return name == "header" || name == "debian_theme" || name == "grub-customizer_menu_color_helper";
+	}
 
-			bool isSubmenu = rule->type == Model_Rule::SUBMENU;
-			std::string scriptName = "", defaultName = "";
-			if (rule->dataSource) {
-				auto script = this->grublistCfg->repository.getScriptByEntry(rule->dataSource);
-				assert(script != nullptr);
-				scriptName = script->name;
+	private: void appendRuleToView(
+		Model_ListCfgSnapshot_Rule const& rule,
+		Model_ListCfgSnapshot_Proxy const& proxy,
+		Model_ListCfgSnapshot_Rule const* parentRule = nullptr
+	) {
+		bool is_other_entries_ph = rule.type == Model_Rule::OTHER_ENTRIES_PLACEHOLDER;
+		bool is_plaintext = rule.dataSource && rule.dataSource->type == Model_Entry::PLAINTEXT;
+		bool is_submenu = rule.type == Model_Rule::SUBMENU;
+
+		if (rule.dataSource || is_submenu){
+			std::string name = this->entryNameMapper->map(rule.dataSource, rule.outputName, true);
+
+			bool isSubmenu = rule.type == Model_Rule::SUBMENU;
+			std::string defaultName = "";
+			if (rule.dataSource) {
+				assert(rule.scriptName != "");
 				if (!is_other_entries_ph && !is_plaintext) {
-					defaultName = rule->dataSource->name;
+					defaultName = rule.dataSource->name;
 				}
 			}
-			bool isEditable = rule->type == Model_Rule::NORMAL || rule->type == Model_Rule::PLAINTEXT;
-			bool isModified = rule->dataSource && rule->dataSource->isModified;
+			bool isEditable = rule.type == Model_Rule::NORMAL || rule.type == Model_Rule::PLAINTEXT;
+			bool isModified = rule.dataSource && rule.dataSource->isModified;
 
 			// parse content to show additional informations
 			std::map<std::string, std::string> options;
-			if (rule->dataSource) {
-				options = Controller_Helper_DeviceInfo::fetch(rule->dataSource->content, *this->contentParserFactory, *deviceDataList);
+			if (rule.dataSource) {
+				options = Controller_Helper_DeviceInfo::fetch(rule.dataSource->content, *this->contentParserFactory, *deviceDataList);
 			}
 
-			auto proxy = this->grublistCfg->proxies.getProxyByRule(rule);
-
 			View_Model_ListItem<Rule, Proxy> listItem;
 			listItem.name = name;
-			listItem.entryPtr = rule.get();
+			listItem.entryPtr = rule.rule.get();
 			listItem.is_placeholder = is_other_entries_ph || is_plaintext;
 			listItem.is_submenu = isSubmenu;
-			listItem.scriptName = scriptName;
+			listItem.scriptName = rule.scriptName;
 			listItem.defaultName = defaultName;
 			listItem.isEditable = isEditable;
 			listItem.isModified = isModified;
 			listItem.options = options;
-			listItem.isVisible = rule->isVisible;
-			listItem.parentEntry = parentRule.get();
-			listItem.parentScript = proxy.get();
+			listItem.isVisible = rule.isVisible;
+			listItem.parentEntry = parentRule ? parentRule->rule.get() : nullptr;
+			listItem.parentScript = proxy.proxy.get();
 			this->view->appendEntry(listItem);
 
-			if (rule->type == Model_Rule::SUBMENU) {
-				for (auto subRule : rule->subRules) {
-					this->appendRuleToView(subRule, rule);
+			if (rule.type == Model_Rule::SUBMENU) {
+				for (auto& subRule : rule.subRules) {
+					this->appendRuleToView(*subRule, proxy, &rule);
 				}
 			}
 		}
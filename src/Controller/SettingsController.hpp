@@ -110,6 +110,8 @@ class SettingsController :
 
 	public: void initApplicationEvents() override
 	{
+		using namespace std::placeholders;
+
 		this->applicationObject->onSettingsShowRequest.addHandler(std::bind(std::mem_fn(&SettingsController::showAction), this));
 		this->applicationObject->onEnvChange.addHandler(std::bind(std::mem_fn(&SettingsController::hideAction), this));
 
@@ -117,7 +119,10 @@ class SettingsController :
 			[this] () {
 				//loading the framebuffer resolutions in background…
 				this->log("Loading Framebuffer resolutions (background process)", Logger::EVENT);
-				this->threadHelper->runAsThread(std::bind(std::mem_fn(&SettingsController::loadResolutionsAction), this));
+				this->threadHelper->runAsThread(
+					std::bind(std::mem_fn(&SettingsController::loadResolutionsAction), this, _1),
+					Controller_Helper_Thread::PRIORITY_LOW
+				);
 			}
 		);
 
@@ -146,11 +151,11 @@ class SettingsController :
 		this->logActionEnd();
 	}
 
-	public: void loadResolutionsAction()
+	public: void loadResolutionsAction(std::shared_ptr<CancellationToken> cancellationToken)
 	{
 		this->logActionBegin("load-resolutions");
 		try {
-			this->fbResolutionsGetter->load();
+			this->fbResolutionsGetter->load(cancellationToken);
 		} catch (Exception const& e) {
 			this->applicationObject->onError.exec(e);
 		}
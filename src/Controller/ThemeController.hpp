@@ -464,7 +464,7 @@ class ThemeController :
 	{
 		this->logActionBegin("update-settings-data");
 		try {
-			std::list<std::string> labelListToplevel  = this->grublistCfg->proxies.getToplevelEntryTitles();
+			std::list<std::string> labelListToplevel  = this->grublistCfg->getSnapshot()->getToplevelEntryTitles();
 	
 			this->view->setPreviewEntryTitles(labelListToplevel);
 	
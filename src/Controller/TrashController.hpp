@@ -185,19 +185,20 @@ class TrashController :
 
 		this->view->clear();
 
-		this->data = this->grublistCfg->getRemovedEntries();
+		auto snapshot = this->grublistCfg->getSnapshot();
+		this->data = snapshot->getRemovedEntries();
 
-		this->refreshView(nullptr);
+		this->refreshView(*snapshot, nullptr);
 	}
 
-	private: void refreshView(std::shared_ptr<Model_Rule> parent)
+	private: void refreshView(Model_ListCfgSnapshot const& snapshot, std::shared_ptr<Model_Rule> parent)
 	{
 		auto& list = parent ? parent->subRules : this->data;
 		for (auto rule : list) {
-			auto script = rule->dataSource ? this->grublistCfg->repository.getScriptByEntry(rule->dataSource) : nullptr;
+			std::string scriptName = rule->dataSource ? snapshot.getScriptName(rule->dataSource) : "";
 
 			std::string name = rule->outputName;
-			if (rule->dataSource && script) {
+			if (rule->dataSource && scriptName != "") {
 				name = this->entryNameMapper->map(rule->dataSource, name, rule->type != Model_Rule::SUBMENU);
 			}
 
@@ -207,7 +208,7 @@ class TrashController :
 			listItem.scriptPtr = nullptr;
 			listItem.is_placeholder = rule->type == Model_Rule::OTHER_ENTRIES_PLACEHOLDER || rule->type == Model_Rule::PLAINTEXT;
 			listItem.is_submenu = rule->type == Model_Rule::SUBMENU;
-			listItem.scriptName = script ? script->name : "";
+			listItem.scriptName = scriptName;
 			listItem.isVisible = true;
 			listItem.parentEntry = parent.get();
 
@@ -222,7 +223,7 @@ class TrashController :
 			this->view->addItem(listItem);
 
 			if (rule->subRules.size()) {
-				this->refreshView(rule);
+				this->refreshView(snapshot, rule);
 			}
 		}
 	}
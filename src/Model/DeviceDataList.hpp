@@ -31,16 +31,30 @@
 #include <map>
 #include <cstdio>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
 #include "../Model/DeviceDataListInterface.hpp"
+#include "../lib/Exception.hpp"
 #include "../lib/Trait/LoggerAware.hpp"
 
 class Model_DeviceDataList : public Model_DeviceDataListInterface, public Trait_LoggerAware {
+	// uuid → device, the first device (in map order) wins. Rebuilt when the number of devices changes
+	mutable std::unordered_map<std::string, std::string> uuidIndex;
+	mutable size_t indexedSize;
 public:
-	Model_DeviceDataList(FILE* blkidOutput){
+	Model_DeviceDataList(FILE* blkidOutput) : indexedSize(-1) {
 		loadData(blkidOutput);
 	}
 
-	Model_DeviceDataList() {}
+	Model_DeviceDataList() : indexedSize(-1) {}
 
 	void loadData(FILE* blkidOutput) {
 		std::string deviceName, attributeName;
@@ -77,21 +91,183 @@ public:
 				}
 			}
 		}
+		this->indexedSize = -1;
+	}
+
+	/**
+	 * builds the same list blkid would output, but without probing the devices:
+	 * the block devices are taken from sysfs, their properties from the udev database
+	 * (which already contains the probing results) and from the /dev/disk/by-* links.
+	 * The devices are read in parallel. Returns false if nothing was found - blkid is
+	 * required in this case (e.g. on systems without udev).
+	 */
+	bool loadFromSystem(std::string const& rootDirectory = "") {
+		std::vector<std::string> kernelNames;
+		DIR* blockDir = opendir((rootDirectory + "/sys/class/block").c_str());
+		if (!blockDir) {
+			return false;
+		}
+		struct dirent* entry;
+		while ((entry = readdir(blockDir))) {
+			if (entry->d_name[0] != '.') {
+				kernelNames.push_back(entry->d_name);
+			}
+		}
+		closedir(blockDir);
+
+		std::vector<std::string> devicePaths(kernelNames.size());
+		std::vector<std::map<std::string, std::string>> properties(kernelNames.size());
+		std::atomic<size_t> nextDevice(0);
+		auto probe = [&] {
+			size_t i;
+			while ((i = nextDevice++) < kernelNames.size()) {
+				devicePaths[i] = Model_DeviceDataList::getDevicePath(rootDirectory, kernelNames[i]);
+				properties[i] = Model_DeviceDataList::readUdevProperties(rootDirectory, kernelNames[i]);
+			}
+		};
+		size_t threadCount = std::max<size_t>(1, std::min<size_t>({4, std::thread::hardware_concurrency(), kernelNames.size()}));
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < threadCount; i++) {
+			threads.push_back(std::thread(probe));
+		}
+		probe();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		// the links are maintained by udev too, but the database may be missing (e.g. in containers)
+		std::map<std::string, size_t> deviceByKernelName;
+		for (size_t i = 0; i < kernelNames.size(); i++) {
+			deviceByKernelName[kernelNames[i]] = i;
+		}
+		std::map<std::string, std::string> linkDirectories = {
+			{"UUID", "/dev/disk/by-uuid"}, {"LABEL", "/dev/disk/by-label"},
+			{"PARTUUID", "/dev/disk/by-partuuid"}, {"PARTLABEL", "/dev/disk/by-partlabel"}
+		};
+		for (auto& linkDirectory : linkDirectories) {
+			for (auto& link : Model_DeviceDataList::readLinks(rootDirectory + linkDirectory.second)) {
+				auto device = deviceByKernelName.find(link.second);
+				if (device != deviceByKernelName.end() && properties[device->second].count(linkDirectory.first) == 0) {
+					properties[device->second][linkDirectory.first] = Model_DeviceDataList::decode(link.first);
+				}
+			}
+		}
+
+		this->clear();
+		for (size_t i = 0; i < kernelNames.size(); i++) {
+			if (properties[i].size()) { // blkid doesn't list devices without properties
+				(*this)[devicePaths[i]] = properties[i];
+			}
+		}
+		return this->size() != 0;
 	}
 
 	void clear() {
 		this->std::map<std::string, std::map<std::string, std::string> >::clear();
+		this->indexedSize = -1;
+	}
+
+	void assign(Model_DeviceDataList const& other) {
+		this->std::map<std::string, std::map<std::string, std::string> >::operator=(other);
+		this->indexedSize = -1;
 	}
 
 	std::string getDeviceByUuid(std::string const& uuid) const {
-		for (std::map<std::string, std::map<std::string, std::string> >::const_iterator iter = this->begin(); iter != this->end(); iter++) {
-			if (iter->second.find("UUID") != iter->second.end() && iter->second.at("UUID") == uuid) {
-				return iter->first;
+		if (this->indexedSize != this->size()) {
+			this->uuidIndex.clear();
+			for (std::map<std::string, std::map<std::string, std::string> >::const_iterator iter = this->begin(); iter != this->end(); iter++) {
+				if (iter->second.find("UUID") != iter->second.end()) {
+					this->uuidIndex.insert(std::make_pair(iter->second.at("UUID"), iter->first));
+				}
 			}
+			this->indexedSize = this->size();
+		}
+		auto indexEntry = this->uuidIndex.find(uuid);
+		if (indexEntry != this->uuidIndex.end()) {
+			return indexEntry->second;
 		}
 		throw ItemNotFoundException("no device found by uuid " + uuid, __FILE__, __LINE__);
 	}
 
+private:
+	// the name used by blkid: device mapper devices are shown by their name, "!" in sysfs names stands for "/"
+	static std::string getDevicePath(std::string const& rootDirectory, std::string const& kernelName) {
+		std::ifstream dmName((rootDirectory + "/sys/class/block/" + kernelName + "/dm/name").c_str());
+		std::string name;
+		if (dmName && std::getline(dmName, name) && name != "") {
+			return "/dev/mapper/" + name;
+		}
+		std::string path = kernelName;
+		std::replace(path.begin(), path.end(), '!', '/');
+		return "/dev/" + path;
+	}
+
+	static std::map<std::string, std::string> readUdevProperties(std::string const& rootDirectory, std::string const& kernelName) {
+		static const std::map<std::string, std::string> udevNames = {
+			{"ID_FS_UUID", "UUID"}, {"ID_FS_UUID_SUB", "UUID_SUB"}, {"ID_FS_LABEL_ENC", "LABEL"}, {"ID_FS_TYPE", "TYPE"},
+			{"ID_PART_ENTRY_UUID", "PARTUUID"}, {"ID_PART_ENTRY_NAME", "PARTLABEL"},
+			{"ID_PART_TABLE_UUID", "PTUUID"}, {"ID_PART_TABLE_TYPE", "PTTYPE"}
+		};
+		std::map<std::string, std::string> result;
+
+		std::ifstream deviceNumberFile((rootDirectory + "/sys/class/block/" + kernelName + "/dev").c_str());
+		std::string deviceNumber;
+		if (!deviceNumberFile || !std::getline(deviceNumberFile, deviceNumber)) {
+			return result;
+		}
+		std::ifstream udevData((rootDirectory + "/run/udev/data/b" + deviceNumber).c_str());
+		std::string line;
+		while (std::getline(udevData, line)) {
+			if (line.compare(0, 2, "E:") != 0) {
+				continue;
+			}
+			size_t separatorPos = line.find('=');
+			if (separatorPos == std::string::npos) {
+				continue;
+			}
+			auto name = udevNames.find(line.substr(2, separatorPos - 2));
+			std::string value = line.substr(separatorPos + 1);
+			if (name != udevNames.end() && value != "") {
+				result[name->second] = Model_DeviceDataList::decode(value);
+			}
+		}
+		return result;
+	}
+
+	// link name → kernel name of the target device
+	static std::map<std::string, std::string> readLinks(std::string const& directory) {
+		std::map<std::string, std::string> result;
+		DIR* dir = opendir(directory.c_str());
+		if (!dir) {
+			return result;
+		}
+		struct dirent* entry;
+		char target[256];
+		while ((entry = readdir(dir))) {
+			ssize_t size = readlink((directory + "/" + entry->d_name).c_str(), target, sizeof(target) - 1);
+			if (size > 0) {
+				target[size] = '\0';
+				char const* targetName = strrchr(target, '/');
+				result[entry->d_name] = targetName ? targetName + 1 : target;
+			}
+		}
+		closedir(dir);
+		return result;
+	}
+
+	// udev encodes unsafe characters like \x20
+	static std::string decode(std::string const& str) {
+		std::string result;
+		for (size_t i = 0; i < str.size(); i++) {
+			if (str[i] == '\\' && i + 3 < str.size() && str[i + 1] == 'x' && isxdigit(str[i + 2]) && isxdigit(str[i + 3])) {
+				result += char(std::stoi(str.substr(i + 2, 2), nullptr, 16));
+				i += 3;
+			} else {
+				result += str[i];
+			}
+		}
+		return result;
+	}
 };
 
 class Model_DeviceDataList_Connection
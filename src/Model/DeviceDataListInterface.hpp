@@ -38,6 +38,7 @@ public:
 
 	virtual void loadData(FILE* blkidOutput)=0;
 	virtual void clear()=0;
+	virtual std::string getDeviceByUuid(std::string const& uuid) const=0;
 };
 
 class Model_DeviceDataListInterface_Connection
@@ -30,7 +30,12 @@
 #define GRUBDEVICEMAP_H_
 #include "../lib/Regex.hpp"
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "Env.hpp"
 #include "SmartFileHandle.hpp"
 
@@ -38,18 +43,38 @@ struct Model_DeviceMap_PartitionIndex {
 	std::string hddNum, partNum;
 };
 
+// device.map and /dev/disk/by-uuid resolved in one pass
+struct Model_DeviceMap_Table {
+	struct Partition {
+		bool isValid; // false if the device name couldn't be split into disk and partition number
+		std::string diskDevice, partNum;
+	};
+	struct Disk {
+		std::string hddNum;
+		size_t row;
+	};
+
+	std::string sourceStamp; // see Model_DeviceMap::getSourceStamp
+	std::unordered_map<std::string, Partition> partitions; // by uuid
+	std::unordered_map<std::string, Disk> disks; // by device name (like "sda"), first row wins
+	size_t firstInvalidRow; // rows not matching "(hdN) file" - -1 if there isn't any
+
+	Model_DeviceMap_Table() : firstInvalidRow(-1) {}
+};
+
 class Model_DeviceMap :
 	public Model_Env_Connection,
 	public Regex_RegexConnection
 {
-	mutable std::map<std::string, Model_DeviceMap_PartitionIndex> _cache;
+	mutable std::shared_ptr<Model_DeviceMap_Table const> table; // accessed by std::atomic_load/std::atomic_store
+	mutable std::mutex buildMutex;
 public:
 	Model_SmartFileHandle getFileHandle() const {
 		Model_SmartFileHandle result;
 		try {
 			result.open(env->devicemap_file, "r", Model_SmartFileHandle::TYPE_FILE);
 		} catch (FileReadException const& e) {
-			if (env->check_cmd(env->mkdevicemap_cmd, env->cmd_prefix)) {
+			if (env->check_cmd(env->mkdevicemap_cmd.substr(env->cmd_prefix.size()), env->cmd_prefix)) {
 				result.open(env->mkdevicemap_cmd, "r", Model_SmartFileHandle::TYPE_COMMAND);
 			} else {
 				std::string staticMap = std::string() +
@@ -86,59 +111,131 @@ public:
 	}
 
 	Model_DeviceMap_PartitionIndex getHarddriveIndexByPartitionUuid(std::string partitionUuid) const {
-		if (this->_cache.find(partitionUuid) != this->_cache.end()) {
-			return this->_cache[partitionUuid];
-		}
-	
 		Model_DeviceMap_PartitionIndex result;
-		char deviceBuf[101];
-		int size = readlink((this->env->cfg_dir_prefix + "/dev/disk/by-uuid/" + partitionUuid).c_str(), deviceBuf, 100);
-		if (size == -1) { //if this didn't work, try to convert the uuid to uppercase
+		std::shared_ptr<Model_DeviceMap_Table const> table = this->getTable();
+
+		auto partition = table->partitions.find(partitionUuid);
+		if (partition == table->partitions.end()) { //if this didn't work, try to convert the uuid to uppercase
 			for (std::string::iterator iter = partitionUuid.begin(); iter != partitionUuid.end(); iter++)
 				*iter = std::toupper(*iter);
-			size = readlink((this->env->cfg_dir_prefix + "/dev/disk/by-uuid/" + partitionUuid).c_str(), deviceBuf, 100);
+			partition = table->partitions.find(partitionUuid);
 		}
-		if (size == -1) {
+		if (partition == table->partitions.end()) {
 			return result; //abort with empty result
 		}
-	
-		deviceBuf[size] = '\0';
-	
-		std::vector<std::string> regexResult = this->regexEngine->match("([^/.0-9]+)([0-9]+)$", deviceBuf);
-		result.partNum = regexResult[2];
-	
-		std::string diskDevice = regexResult[1];
-	
-		Model_SmartFileHandle handle = this->getFileHandle();
-	
-		try {
-			while (result.hddNum == "") {
-				std::string row = handle.getRow();
-				std::vector<std::string> rowMatch = this->regexEngine->match("^\\(hd([0-9]+)\\)[\t ]*(.*)$", row);
-				std::string diskFile = rowMatch[2];
-	
-				int size = readlink(diskFile.c_str(), deviceBuf, 100); // if this is a link, follow it
-				if (size != -1) {
-					diskFile = std::string(deviceBuf, size);
+		if (!partition->second.isValid) {
+			throw RegExNotMatchedException("RegEx doesn't match", __FILE__, __LINE__);
+		}
+		result.partNum = partition->second.partNum;
+
+		auto disk = table->disks.find(partition->second.diskDevice);
+		if (disk != table->disks.end() && disk->second.row < table->firstInvalidRow) {
+			result.hddNum = disk->second.hddNum;
+		} else if (table->firstInvalidRow != size_t(-1)) {
+			// reading the map row by row would have failed at this row
+			throw RegExNotMatchedException("RegEx doesn't match", __FILE__, __LINE__);
+		}
+		return result;
+	}
+
+	/**
+	 * resolves the device map and the partition uuids if they changed since the last call.
+	 * Is called on demand, but should be called in background before to avoid waiting for
+	 * the device map generation.
+	 */
+	void buildTable() const {
+		std::lock_guard<std::mutex> lock(this->buildMutex);
+		std::string sourceStamp = this->getSourceStamp();
+		std::shared_ptr<Model_DeviceMap_Table const> currentTable = std::atomic_load(&this->table);
+		if (currentTable && currentTable->sourceStamp == sourceStamp) {
+			return;
+		}
+
+		auto newTable = std::make_shared<Model_DeviceMap_Table>();
+		newTable->sourceStamp = sourceStamp;
+		char deviceBuf[101];
+
+		std::string byUuidDirectory = this->env->cfg_dir_prefix + "/dev/disk/by-uuid/";
+		DIR* dir = opendir(byUuidDirectory.c_str());
+		if (dir) {
+			struct dirent* entry;
+			while ((entry = readdir(dir))) {
+				int size = readlink((byUuidDirectory + entry->d_name).c_str(), deviceBuf, 100);
+				if (size == -1) {
+					continue;
 				}
-	
-				int deviceStartPos = (int)diskFile.size() - diskDevice.size();
-				if (deviceStartPos > 1 && diskFile.substr(deviceStartPos - 1) == "/" + diskDevice) {
-					result.hddNum = rowMatch[1];
-					break;
+				deviceBuf[size] = '\0';
+				Model_DeviceMap_Table::Partition partition;
+				try {
+					std::vector<std::string> regexResult = this->regexEngine->match("([^/.0-9]+)([0-9]+)$", deviceBuf);
+					partition.isValid = true;
+					partition.diskDevice = regexResult[1];
+					partition.partNum = regexResult[2];
+				} catch (RegExNotMatchedException const& e) {
+					partition.isValid = false;
+				}
+				newTable->partitions[entry->d_name] = partition;
+			}
+			closedir(dir);
+		}
+
+		Model_SmartFileHandle handle = this->getFileHandle();
+		std::string rowText;
+		for (size_t row = 0; handle.readRow(rowText); row++) {
+			std::vector<std::string> rowMatch;
+			try {
+				rowMatch = this->regexEngine->match("^\\(hd([0-9]+)\\)[\t ]*(.*)$", rowText);
+			} catch (RegExNotMatchedException const& e) {
+				newTable->firstInvalidRow = row;
+				break;
+			}
+			std::string diskFile = rowMatch[2];
+
+			int size = readlink(diskFile.c_str(), deviceBuf, 100); // if this is a link, follow it
+			if (size != -1) {
+				diskFile = std::string(deviceBuf, size);
+			}
+
+			size_t lastSlashPos = diskFile.rfind('/');
+			if (lastSlashPos != std::string::npos && lastSlashPos >= 1 && lastSlashPos + 1 < diskFile.size()) {
+				std::string diskDevice = diskFile.substr(lastSlashPos + 1);
+				if (newTable->disks.find(diskDevice) == newTable->disks.end()) {
+					newTable->disks[diskDevice] = {rowMatch[1], row};
 				}
 			}
-		} catch (EndOfFileException const& e) {
-			//don't throw if we didn't find the mapped value
 		}
 		handle.close();
-	
-		this->_cache[partitionUuid] = result;
-		return result;
+
+		std::atomic_store(&this->table, std::shared_ptr<Model_DeviceMap_Table const>(newTable));
 	}
 
 	void clearCache() {
-		this->_cache.clear();
+		std::atomic_store(&this->table, std::shared_ptr<Model_DeviceMap_Table const>());
+	}
+
+private:
+	std::shared_ptr<Model_DeviceMap_Table const> getTable() const {
+		std::shared_ptr<Model_DeviceMap_Table const> table = std::atomic_load(&this->table);
+		if (!table || table->sourceStamp != this->getSourceStamp()) {
+			this->buildTable();
+			table = std::atomic_load(&this->table);
+		}
+		return table;
+	}
+
+	// changes when the device map or the partition links are modified
+	std::string getSourceStamp() const {
+		return this->env->cfg_dir_prefix + "\n" + this->env->devicemap_file + "\n" + this->env->mkdevicemap_cmd
+			+ "\n" + Model_DeviceMap::getModificationTime(this->env->devicemap_file)
+			+ "\n" + Model_DeviceMap::getModificationTime(this->env->cfg_dir_prefix + "/dev/disk/by-uuid");
+	}
+
+	static std::string getModificationTime(std::string const& path) {
+		struct stat fileProperties;
+		if (stat(path.c_str(), &fileProperties) != 0) {
+			return "-";
+		}
+		return std::to_string(fileProperties.st_mtim.tv_sec) + "." + std::to_string(fileProperties.st_mtim.tv_nsec);
 	}
 
 };
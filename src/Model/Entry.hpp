@@ -29,41 +29,79 @@
 #ifndef GRUB_CUSTOMIZER_ENTRY_INCLUDED
 #define GRUB_CUSTOMIZER_ENTRY_INCLUDED
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <list>
 #include <memory>
+#include <atomic>
 #include "../lib/Trait/LoggerAware.hpp"
 #include "../lib/Helper.hpp"
 #include "../lib/ArrayStructure.hpp"
 #include "../lib/Type.hpp"
+#include "../lib/LineReader.hpp"
 
 class Model_Entry_Row
 {
-	public: Model_Entry_Row(FILE* sourceFile) : eof(false), is_loaded(true)
-	{
-		this->eof = true; //will be set to false on the first loop run
-		int c;
-		while ((c = fgetc(sourceFile)) != EOF){
-			this->eof = false;
-			if (c != '\n'){
-				this->text += char(c);
-			}
-			else {
-				break;
-			}
-		}
+	public: Model_Entry_Row(LineReader& source) : data(""), length(0), eof(false), is_loaded(true)
+	{
+		this->eof = !source.readLine(this->data, this->length);
 	}
 
-	public: Model_Entry_Row() : eof(false), is_loaded(true)
+	public: Model_Entry_Row() : data(""), length(0), eof(false), is_loaded(true)
 	{}
 
-	public: std::string text;
+	// points into the buffer of the LineReader - only valid until the next row is read
+	public: char const* data;
+	public: size_t length;
 	public: bool eof;
 	public: bool is_loaded;
 	public: operator bool()
 	{
 		return !eof && is_loaded;
 	}
+
+	public: std::string text() const
+	{
+		return std::string(this->data, this->length);
+	}
+
+	// the same row without leading whitespace (like Helper::ltrim, but without copying)
+	public: Model_Entry_Row ltrim() const
+	{
+		Model_Entry_Row result = *this;
+		while (result.length && Model_Entry_Row::isSpace(*result.data)) {
+			result.data++;
+			result.length--;
+		}
+		return result;
+	}
+
+	public: bool startsWith(char const* prefix) const
+	{
+		size_t prefixLength = strlen(prefix);
+		return this->length >= prefixLength && memcmp(this->data, prefix, prefixLength) == 0;
+	}
+
+	public: bool endsWith(char const* suffix) const
+	{
+		size_t suffixLength = strlen(suffix);
+		return this->length >= suffixLength && memcmp(this->data + this->length - suffixLength, suffix, suffixLength) == 0;
+	}
+
+	// compares the row with leading and trailing whitespace removed (like Helper::trim(row) == str)
+	public: bool equalsTrimmed(char const* str) const
+	{
+		Model_Entry_Row trimmed = this->ltrim();
+		while (trimmed.length && Model_Entry_Row::isSpace(trimmed.data[trimmed.length - 1])) {
+			trimmed.length--;
+		}
+		return trimmed.length == strlen(str) && memcmp(trimmed.data, str, trimmed.length) == 0;
+	}
+
+	private: static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
 };
 
 class Model_Entry : public Trait_LoggerAware, public Entry
@@ -81,6 +119,8 @@ class Model_Entry : public Trait_LoggerAware, public Entry
 	public: char quote;
 	public: std::list<std::shared_ptr<Model_Entry>> subEntries;
 
+	private: mutable std::string contentHash; // lazily calculated md5 of content - empty if not yet calculated
+
 	public: Model_Entry()
 		: isValid(false), isModified(false), quote('\''), type(MENUENTRY)
 	{}
@@ -89,7 +129,7 @@ class Model_Entry : public Trait_LoggerAware, public Entry
 		: name(name), extension(extension), content(content), isValid(true), type(type), isModified(false), quote('\'')
 	{}
 	
-	public: Model_Entry(FILE* sourceFile, Model_Entry_Row firstRow = Model_Entry_Row(), std::shared_ptr<Logger> logger = nullptr, std::string* plaintextBuffer = NULL)
+	public: Model_Entry(LineReader& sourceFile, Model_Entry_Row firstRow = Model_Entry_Row(), std::shared_ptr<Logger> logger = nullptr, std::string* plaintextBuffer = NULL)
 		: isValid(false), type(MENUENTRY), quote('\''), isModified(false)
 	{
 		if (logger) {
@@ -97,26 +137,27 @@ class Model_Entry : public Trait_LoggerAware, public Entry
 		}
 		Model_Entry_Row row;
 		while ((row = firstRow) || (row = Model_Entry_Row(sourceFile))){
-			std::string rowText = Helper::ltrim(row.text);
+			Model_Entry_Row rowText = row.ltrim();
 	
-			if (rowText.substr(0, 10) == "menuentry "){
+			if (rowText.startsWith("menuentry ")){
 				this->readMenuEntry(sourceFile, row);
 				break;
-			} else if (rowText.substr(0, 8) == "submenu ") {
+			} else if (rowText.startsWith("submenu ")) {
 				this->readSubmenu(sourceFile, row);
 				break;
 			} else {
 				if (plaintextBuffer) {
-					*plaintextBuffer += row.text + "\r\n";
+					plaintextBuffer->append(row.data, row.length);
+					*plaintextBuffer += "\r\n";
 				}
 			}
 			firstRow.eof = true; //disable firstRow to read the following config from file
 		}
 	}
 	
-	private: void readSubmenu(FILE* sourceFile, Model_Entry_Row firstRow)
+	private: void readSubmenu(LineReader& sourceFile, Model_Entry_Row firstRow)
 	{
-		std::string rowText = Helper::ltrim(firstRow.text);
+		std::string rowText = firstRow.ltrim().text();
 		int endOfEntryName = rowText.find('"', 10);
 		if (endOfEntryName == -1)
 			endOfEntryName = rowText.find('\'', 10);
@@ -128,20 +169,20 @@ class Model_Entry : public Trait_LoggerAware, public Entry
 		}
 		Model_Entry_Row row;
 		while ((row = Model_Entry_Row(sourceFile))) {
-			std::string rowText = Helper::ltrim(row.text);
+			Model_Entry_Row rowText = row.ltrim();
 	
-			if (rowText.substr(0, 10) == "menuentry " || rowText.substr(0, 8) == "submenu "){
+			if (rowText.startsWith("menuentry ") || rowText.startsWith("submenu ")){
 				this->subEntries.push_back(std::make_shared<Model_Entry>(sourceFile, row));
-			} else if (Helper::trim(rowText) == "}") {
+			} else if (rowText.equalsTrimmed("}")) {
 				this->isValid = true;
 				break; //read only one submenu
 			}
 		}
 	}
 
-	private: void readMenuEntry(FILE* sourceFile, Model_Entry_Row firstRow)
+	private: void readMenuEntry(LineReader& sourceFile, Model_Entry_Row firstRow)
 	{
-		std::string rowText = Helper::ltrim(firstRow.text);
+		std::string rowText = firstRow.ltrim().text();
 		char quote = '"';
 		int endOfEntryName = rowText.find('"', 12);
 		if (endOfEntryName == -1) {
@@ -165,16 +206,17 @@ class Model_Entry : public Trait_LoggerAware, public Entry
 	
 		Model_Entry_Row row;
 		while ((row = Model_Entry_Row(sourceFile))){
-			std::string rowText = Helper::ltrim(row.text);
+			Model_Entry_Row rowText = row.ltrim();
 	
-			if (Helper::trim(rowText) == "}" && --depth == 0) {
+			if (rowText.equalsTrimmed("}") && --depth == 0) {
 				this->isValid = true;
 				break; //read only one menuentry
 			} else {
-				if (rowText.substr(0, 10) == "menuentry ") {
+				if (rowText.startsWith("menuentry ")) {
 					depth++;
 				}
-				this->content += row.text+"\n";
+				this->content.append(row.data, row.length);
+				this->content += '\n';
 			}
 		}
 	}
@@ -184,6 +226,63 @@ class Model_Entry : public Trait_LoggerAware, public Entry
 		return this->subEntries;
 	}
 
+	// md5 of content - calculated once and cached until the content is changed using setContent
+	public: std::string const& getContentHash() const
+	{
+		if (this->contentHash == "") {
+			this->contentHash = Helper::md5(this->content);
+		}
+		return this->contentHash;
+	}
+
+	// content and name must be changed using the setters after parsing to keep the lookup indexes up to date
+	public: void setContent(std::string const& content)
+	{
+		if (content == this->content) {
+			return; // keep the cached hash
+		}
+		this->content = content;
+		this->contentHash = "";
+		Model_Entry::modificationCounter()++;
+	}
+
+	public: void setName(std::string const& name)
+	{
+		this->name = name;
+		Model_Entry::modificationCounter()++;
+	}
+
+	public: void setType(EntryType type)
+	{
+		this->type = type;
+		Model_Entry::modificationCounter()++;
+	}
+
+	// incremented on each change of an existing entry, used to detect outdated entry indexes
+	public: static std::atomic<unsigned long>& modificationCounter()
+	{
+		static std::atomic<unsigned long> counter(0);
+		return counter;
+	}
+
+	// true if both entries (including their sub entries) would generate the same output
+	public: bool equals(Model_Entry const& other) const
+	{
+		if (this->type != other.type || this->isValid != other.isValid || this->isModified != other.isModified
+			|| this->name != other.name || this->extension != other.extension || this->content != other.content
+			|| this->quote != other.quote || this->subEntries.size() != other.subEntries.size()) {
+			return false;
+		}
+		auto otherIter = other.subEntries.begin();
+		for (auto subEntry : this->subEntries) {
+			if (subEntry != *otherIter && !subEntry->equals(**otherIter)) {
+				return false;
+			}
+			otherIter++;
+		}
+		return true;
+	}
+
 	public: operator bool() const
 	{
 		return isValid;
@@ -32,6 +32,9 @@
 #include <cstdlib>
 #include <dirent.h>
 #include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include "../lib/ArrayStructure.hpp"
@@ -49,21 +52,31 @@ public:
 		BURG_MODE
 	};
 
+	enum ScriptOutputCacheMode {
+		OUTPUT_CACHE_DISABLED,
+		OUTPUT_CACHE_ENABLED,
+		OUTPUT_CACHE_VALIDATION // run all scripts and compare their output to the cache
+	};
+
 	// application status flags:
 	bool quit_requested;
 	int activeThreadCount;
 	bool modificationsUnsaved;
 	std::string rootDeviceName;
 
-	Model_Env() : burgMode(false),
-		  useDirectBackgroundProps(false),
+	Model_Env() : quit_requested(false),
+		  activeThreadCount(0),
 		  modificationsUnsaved(false),
-		  quit_requested(false),
-		  activeThreadCount(0)
+		  burgMode(false),
+		  useDirectBackgroundProps(false),
+		  parallelScriptExecution(false),
+		  scriptOutputCacheMode(OUTPUT_CACHE_DISABLED)
 	{}
 
 	bool init(Model_Env::Mode mode, std::string const& dir_prefix) {
 		useDirectBackgroundProps = false;
+		parallelScriptExecution = false;
+		scriptOutputCacheMode = OUTPUT_CACHE_DISABLED;
 		this->cmd_prefix = dir_prefix != "" ? "chroot '"+dir_prefix+"' " : "";
 		this->cfg_dir_prefix = dir_prefix;
 		std::string output_config_file_noprefix;
@@ -139,6 +152,8 @@ public:
 		this->output_config_file = dir_prefix + ds.getValue("OUTPUT_FILE");
 		this->settings_file = dir_prefix + ds.getValue("SETTINGS_FILE");
 		this->devicemap_file = dir_prefix + ds.getValue("DEVICEMAP_FILE");
+		this->parallelScriptExecution = ds.getValue("PARALLEL_SCRIPT_EXECUTION") == "true";
+		this->scriptOutputCacheMode = this->parseScriptOutputCacheMode(ds.getValue("SCRIPT_OUTPUT_CACHE"));
 	}
 
 	void save() {
@@ -242,6 +257,12 @@ public:
 		result["OUTPUT_FILE"] = this->output_config_file.substr(this->cfg_dir_prefix.size());
 		result["SETTINGS_FILE"] = this->settings_file.substr(this->cfg_dir_prefix.size());
 		result["DEVICEMAP_FILE"] = this->devicemap_file.substr(this->cfg_dir_prefix.size());
+		result["PARALLEL_SCRIPT_EXECUTION"] = this->parallelScriptExecution ? "true" : "false";
+		switch (this->scriptOutputCacheMode) {
+		case OUTPUT_CACHE_ENABLED: result["SCRIPT_OUTPUT_CACHE"] = "true"; break;
+		case OUTPUT_CACHE_VALIDATION: result["SCRIPT_OUTPUT_CACHE"] = "validate"; break;
+		default: result["SCRIPT_OUTPUT_CACHE"] = "false";
+		}
 	
 		return result;
 	}
@@ -258,6 +279,18 @@ public:
 		this->output_config_file = this->cfg_dir_prefix + props.at("OUTPUT_FILE");
 		this->settings_file = this->cfg_dir_prefix + props.at("SETTINGS_FILE");
 		this->devicemap_file = this->cfg_dir_prefix + props.at("DEVICEMAP_FILE");
+		this->parallelScriptExecution = props.at("PARALLEL_SCRIPT_EXECUTION") == "true";
+		this->scriptOutputCacheMode = this->parseScriptOutputCacheMode(props.at("SCRIPT_OUTPUT_CACHE"));
+	}
+
+	ScriptOutputCacheMode parseScriptOutputCacheMode(std::string const& value) const {
+		if (value == "true") {
+			return OUTPUT_CACHE_ENABLED;
+		} else if (value == "validate") {
+			return OUTPUT_CACHE_VALIDATION;
+		} else {
+			return OUTPUT_CACHE_DISABLED;
+		}
 	}
 
 	std::list<std::string> getRequiredProperties() {
@@ -297,10 +330,48 @@ public:
 		if (this->check_file(this->devicemap_file)) {
 			result.push_back("DEVICEMAP_FILE");
 		}
+		result.push_back("PARALLEL_SCRIPT_EXECUTION"); // "true" enables it, everything else disables it
+		result.push_back("SCRIPT_OUTPUT_CACHE"); // "true", "validate" or disabled
 		return result;
 	}
 
+	/**
+	 * checks whether the command can be found like "which" would do - but without running it:
+	 * the PATH is searched inside of cfg_dir_prefix if the command is run using cmd_prefix (chroot).
+	 * The results are cached until clearCommandCache is called.
+	 */
 	bool check_cmd(std::string const& cmd, std::string const& cmd_prefix = "") const {
+		std::string command = this->trim_cmd(cmd);
+		if (cmd_prefix != "" && cmd_prefix != this->cmd_prefix) {
+			return this->check_cmd_using_which(cmd, cmd_prefix); // unknown root directory
+		}
+		std::string rootDirectory = cmd_prefix != "" ? this->cfg_dir_prefix : "";
+
+		std::lock_guard<std::mutex> lock(this->commandCacheMutex);
+		auto cacheKey = std::make_pair(rootDirectory, command);
+		auto cachedPath = this->commandCache.find(cacheKey);
+		if (cachedPath != this->commandCache.end()) {
+			return cachedPath->second != "";
+		}
+
+		this->log("checking the " + command + " command… ", Logger::INFO);
+		std::string path = this->findCommand(command, rootDirectory);
+		if (path != "") {
+			this->log("found at: " + path, Logger::INFO);
+		} else {
+			this->log("not found", Logger::INFO);
+		}
+		this->commandCache[cacheKey] = path;
+		return path != "";
+	}
+
+	// must be called if the commands may have changed (e.g. different partition mounted at the same root)
+	void clearCommandCache() {
+		std::lock_guard<std::mutex> lock(this->commandCacheMutex);
+		this->commandCache.clear();
+	}
+
+	bool check_cmd_using_which(std::string const& cmd, std::string const& cmd_prefix = "") const {
 		this->log("checking the " + this->trim_cmd(cmd) + " command… ", Logger::INFO);
 		FILE* proc = popen((cmd_prefix + " which " + this->trim_cmd(cmd) + " 2>&1").c_str(), "r");
 		std::string output;
@@ -347,18 +418,16 @@ public:
 	}
 
 	std::string getRootDevice() {
-		FILE* mtabFile = fopen("/etc/mtab", "r");
 		Model_MountTable mtab;
-		if (mtabFile){
-			mtab.loadData(mtabFile, "");
-			fclose(mtabFile);
-		}
+		mtab.loadMounted();
 		return mtab.getEntryByMountpoint(cfg_dir_prefix == "" ? "/" : cfg_dir_prefix).device;
 	}
 
 	std::string cfg_dir, cfg_dir_noprefix, mkconfig_cmd, mkfont_cmd, cfg_dir_prefix, update_cmd, install_cmd, output_config_file, output_config_dir, output_config_dir_noprefix, settings_file, devicemap_file, mkdevicemap_cmd, cmd_prefix;
 	bool burgMode;
 	bool useDirectBackgroundProps; // Whether background settings should be set directly or by creating a desktop-base script
+	bool parallelScriptExecution; // Whether the scripts should be run in parallel instead of using mkconfig_cmd (see Model_ParallelScriptRunner)
+	ScriptOutputCacheMode scriptOutputCacheMode; // the output cache also uses Model_ParallelScriptRunner
 	std::list<Model_Env::Mode> getAvailableModes() {
 		std::list<Mode> result;
 		if (this->init(Model_Env::BURG_MODE, this->cfg_dir_prefix))
@@ -414,6 +483,8 @@ public:
 		result["cmd_prefix"] = this->cmd_prefix;
 		result["burgMode"] = this->burgMode;
 		result["useDirectBackgroundProps"] = this->useDirectBackgroundProps;
+		result["parallelScriptExecution"] = this->parallelScriptExecution;
+		result["scriptOutputCacheMode"] = this->scriptOutputCacheMode;
 		result["quit_requested"] = this->quit_requested;
 		result["activeThreadCount"] = this->activeThreadCount;
 		result["modificationsUnsaved"] = this->modificationsUnsaved;
@@ -421,6 +492,64 @@ public:
 		return result;
 	}
 
+private:
+	mutable std::map<std::pair<std::string, std::string>, std::string> commandCache; // (root directory, command) → path, empty if not found
+	mutable std::mutex commandCacheMutex;
+
+	// returns the path of the command (relative to the root directory) or an empty string
+	std::string findCommand(std::string const& command, std::string const& rootDirectory) const {
+		std::list<std::string> candidates;
+		if (command.find('/') != std::string::npos) {
+			candidates.push_back(command);
+		} else {
+			char const* pathVariable = getenv("PATH");
+			std::string searchPath = pathVariable ? pathVariable : "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin";
+			size_t start = 0, end;
+			do {
+				end = searchPath.find(':', start);
+				std::string directory = searchPath.substr(start, end == std::string::npos ? std::string::npos : end - start);
+				candidates.push_back((directory == "" ? "." : directory) + "/" + command);
+				start = end + 1;
+			} while (end != std::string::npos);
+		}
+
+		for (auto& candidate : candidates) {
+			std::string resolvedPath = this->resolveInRoot(candidate, rootDirectory);
+			struct stat fileProperties;
+			if (resolvedPath != ""
+				&& stat((rootDirectory + resolvedPath).c_str(), &fileProperties) == 0 && S_ISREG(fileProperties.st_mode)
+				&& faccessat(AT_FDCWD, (rootDirectory + resolvedPath).c_str(), X_OK, AT_EACCESS) == 0) {
+				return candidate;
+			}
+		}
+		return "";
+	}
+
+	// follows symlinks - absolute targets point into the root directory. Returns an empty string if the file doesn't exist
+	std::string resolveInRoot(std::string path, std::string const& rootDirectory) const {
+		char target[4096];
+		for (int i = 0; i < 40; i++) { // the kernel gives up after 40 links too
+			struct stat fileProperties;
+			if (lstat((rootDirectory + path).c_str(), &fileProperties) != 0) {
+				return "";
+			}
+			if (!S_ISLNK(fileProperties.st_mode)) {
+				return path;
+			}
+			ssize_t size = readlink((rootDirectory + path).c_str(), target, sizeof(target) - 1);
+			if (size <= 0) {
+				return "";
+			}
+			target[size] = '\0';
+			if (target[0] == '/') {
+				path = target;
+			} else {
+				path = path.substr(0, path.rfind('/') + 1) + target;
+			}
+		}
+		return "";
+	}
+
 };
 
 class Model_Env_Connection
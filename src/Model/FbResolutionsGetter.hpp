@@ -28,58 +28,259 @@
 #define FB_RESOLUTIONS_GETTER
 #include <string>
 #include <list>
+#include <vector>
+#include <set>
 #include <cstdio>
 #include <functional>
+#include <mutex>
+#include <atomic>
+#include <dirent.h>
 #include "../lib/Trait/LoggerAware.hpp"
+#include "../lib/CancellationToken.hpp"
+#include "../lib/ChildProcess.hpp"
+#include "../lib/LineReader.hpp"
+#include "../lib/Helper.hpp"
+#include "ScriptOutputCache.hpp"
 
+/**
+ * lists the resolutions supported by the connected monitors. The modes are read from
+ * /sys/class/drm (mode lists of the connectors and their EDID blobs), "hwinfo --framebuffer"
+ * is only used if there aren't any DRM modes. The result is cached together with a hardware
+ * identity (connectors and EDID hashes): the cached list is available immediately, the modes
+ * are refreshed afterwards - hwinfo isn't run again as long as the hardware doesn't change.
+ */
 class Model_FbResolutionsGetter : public Trait_LoggerAware {
 	std::list<std::string> data;
-	bool _isLoading;
+	mutable std::mutex dataMutex;
+	std::atomic<bool> _isLoading;
+	std::string cacheDir, drmDirectory;
 public:
-	Model_FbResolutionsGetter() : _isLoading(false)
+	Model_FbResolutionsGetter(std::string const& cacheDir = "/var/cache/grub-customizer", std::string const& drmDirectory = "/sys/class/drm")
+		: _isLoading(false), cacheDir(cacheDir), drmDirectory(drmDirectory)
 	{}
 
 	std::function<void ()> onFinish;
 
-	const std::list<std::string>& getData() const {
+	std::list<std::string> getData() const {
+		std::lock_guard<std::mutex> lock(this->dataMutex);
 		return data;
 	}
 
-	void load() {
-		if (!_isLoading){ //make sure that only one thread is running this function at the same time
-			_isLoading = true;
-			data.clear();
-			FILE* hwinfo_proc = popen("hwinfo --framebuffer", "r");
-			if (hwinfo_proc){
-				int c;
-				std::string row;
-				//parses mode lines like "  Mode 0x0300: 640x400 (+640), 8 bits"
-				while ((c = fgetc(hwinfo_proc)) != EOF){
-					if (c != '\n')
-						row += char(c);
-					else {
-						if (row.substr(0,7) == "  Mode "){
-							int beginOfResulution = row.find(':')+2;
-							int endOfResulution = row.find(' ', beginOfResulution);
-	
-							int beginOfColorDepth = row.find(' ', endOfResulution+1)+1;
-							int endOfColorDepth = row.find(' ', beginOfColorDepth);
-	
-							data.push_back(
-								row.substr(beginOfResulution, endOfResulution-beginOfResulution)
-							  + "x"
-							  + row.substr(beginOfColorDepth, endOfColorDepth-beginOfColorDepth)
-							);
-						}
-						row = "";
-					}
+	// hwinfo is killed if the token is cancelled
+	void load(std::shared_ptr<CancellationToken> cancellationToken = nullptr) {
+		if (_isLoading.exchange(true)) { //make sure that only one thread is running this function at the same time
+			return;
+		}
+		Model_ScriptOutputCache cache(this->cacheDir);
+		if (this->logger) {
+			cache.setLogger(this->logger);
+		}
+		std::list<std::string> drmConnectors = this->getDrmConnectors();
+		std::string hardwareIdentity = this->getHardwareIdentity(drmConnectors);
+
+		std::string cachedModes;
+		bool cacheIsValid = cache.load("framebuffer-modes", hardwareIdentity, cachedModes);
+		if (cacheIsValid) {
+			this->log("using cached framebuffer modes", Logger::INFO);
+			this->setData(Model_FbResolutionsGetter::split(cachedModes));
+		}
+
+		bool loaded = true;
+		std::list<std::string> modes = this->readDrmModes(drmConnectors);
+		if (modes.size() == 0 && !cacheIsValid) {
+			this->log("no DRM modes found - running hwinfo", Logger::INFO);
+			loaded = this->readHwinfoModes(modes, cancellationToken);
+		}
+		if (loaded && (modes.size() || !cacheIsValid)) {
+			std::string modeList;
+			for (auto& mode : modes) {
+				modeList += mode + "\n";
+			}
+			if (!cacheIsValid || modeList != cachedModes) {
+				this->setData(modes);
+			}
+			cache.save("framebuffer-modes", hardwareIdentity, modeList);
+		}
+		_isLoading = false;
+	}
+
+private:
+	// updates the list and notifies the listener if it has changed
+	void setData(std::list<std::string> const& newData) {
+		std::unique_lock<std::mutex> lock(this->dataMutex);
+		if (newData == this->data) {
+			return;
+		}
+		this->data = newData;
+		lock.unlock();
+		if (this->onFinish) {
+			this->onFinish();
+		}
+	}
+
+	// connector directories like "card0-HDMI-A-1"
+	std::list<std::string> getDrmConnectors() const {
+		std::list<std::string> result;
+		DIR* dir = opendir(this->drmDirectory.c_str());
+		if (dir) {
+			struct dirent* entry;
+			while ((entry = readdir(dir))) {
+				std::string name = entry->d_name;
+				if (name.compare(0, 4, "card") == 0 && name.find('-') != std::string::npos) {
+					result.push_back(name);
+				}
+			}
+			closedir(dir);
+		}
+		result.sort();
+		return result;
+	}
+
+	std::string getHardwareIdentity(std::list<std::string> const& drmConnectors) const {
+		std::string identity;
+		for (auto& connector : drmConnectors) {
+			identity += connector + ":" + Helper::md5(Model_FbResolutionsGetter::readFile(this->drmDirectory + "/" + connector + "/edid")) + ",";
+		}
+		identity += Helper::md5(Model_FbResolutionsGetter::readFile("/proc/fb")); // hwinfo reports the modes of the framebuffer devices
+		return identity;
+	}
+
+	// modes from the connectors and their EDID - sorted by size, without refresh rate
+	std::list<std::string> readDrmModes(std::list<std::string> const& drmConnectors) const {
+		std::set<std::pair<int, int>> resolutions;
+		for (auto& connector : drmConnectors) {
+			for (auto& mode : Model_FbResolutionsGetter::split(Model_FbResolutionsGetter::readFile(this->drmDirectory + "/" + connector + "/modes"))) {
+				int width = 0, height = 0;
+				char suffix = '\0';
+				// interlaced modes ("1920x1080i") cannot be used for the framebuffer
+				if (sscanf(mode.c_str(), "%dx%d%c", &width, &height, &suffix) >= 2 && suffix != 'i') {
+					resolutions.insert(std::make_pair(width, height));
+				}
+			}
+			Model_FbResolutionsGetter::parseEdid(Model_FbResolutionsGetter::readFile(this->drmDirectory + "/" + connector + "/edid"), resolutions);
+		}
+		std::list<std::string> result;
+		for (auto& resolution : resolutions) {
+			if (resolution.first > 0 && resolution.second > 0) {
+				result.push_back(std::to_string(resolution.first) + "x" + std::to_string(resolution.second));
+			}
+		}
+		return result;
+	}
+
+	// adds the established, standard and detailed timings of the EDID base block
+	static void parseEdid(std::string const& edid, std::set<std::pair<int, int>>& resolutions) {
+		static const unsigned char header[] = {0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00};
+		if (edid.size() < 128 || edid.compare(0, 8, std::string(reinterpret_cast<char const*>(header), 8)) != 0) {
+			return;
+		}
+		unsigned char const* block = reinterpret_cast<unsigned char const*>(edid.data());
+
+		static const int establishedTimings[17][2] = {
+			{720, 400}, {720, 400}, {640, 480}, {640, 480}, {640, 480}, {640, 480}, {800, 600}, {800, 600},
+			{800, 600}, {800, 600}, {832, 624}, {1024, 768}, {1024, 768}, {1024, 768}, {1024, 768}, {1280, 1024},
+			{1152, 870}
+		};
+		for (int i = 0; i < 17; i++) {
+			if (block[35 + i / 8] & (0x80 >> (i % 8))) {
+				if (i != 11) { // 1024x768 interlaced
+					resolutions.insert(std::make_pair(establishedTimings[i][0], establishedTimings[i][1]));
 				}
-				if (pclose(hwinfo_proc) == 0 && this->onFinish) {
-					this->onFinish();
+			}
+		}
+
+		for (int i = 38; i < 54; i += 2) {
+			Model_FbResolutionsGetter::addStandardTiming(block[i], block[i + 1], block[18] == 1 && block[19] < 3, resolutions);
+		}
+
+		for (int descriptor = 54; descriptor < 126; descriptor += 18) {
+			unsigned char const* timing = block + descriptor;
+			if (timing[0] || timing[1]) { // pixel clock set: detailed timing
+				if ((timing[17] & 0x80) == 0) { // not interlaced
+					resolutions.insert(std::make_pair(timing[2] | (timing[4] & 0xf0) << 4, timing[5] | (timing[7] & 0xf0) << 4));
+				}
+			} else if (timing[3] == 0xfa) { // additional standard timings
+				for (int i = 5; i < 17; i += 2) {
+					Model_FbResolutionsGetter::addStandardTiming(timing[i], timing[i + 1], false, resolutions);
+				}
+			}
+		}
+	}
+
+	// before EDID 1.3, aspect ratio 0 means 1:1 instead of 16:10
+	static void addStandardTiming(unsigned char first, unsigned char second, bool isSquareDefault, std::set<std::pair<int, int>>& resolutions) {
+		if ((first == 0x01 && second == 0x01) || first == 0x00) {
+			return; // unused
+		}
+		int width = (first + 31) * 8;
+		int height = 0;
+		switch (second >> 6) {
+			case 0: height = isSquareDefault ? width : width * 10 / 16; break;
+			case 1: height = width * 3 / 4; break;
+			case 2: height = width * 4 / 5; break;
+			case 3: height = width * 9 / 16; break;
+		}
+		resolutions.insert(std::make_pair(width, height));
+	}
+
+	bool readHwinfoModes(std::list<std::string>& modes, std::shared_ptr<CancellationToken> cancellationToken) const {
+		ChildProcess hwinfo;
+		FILE* hwinfo_proc = hwinfo.open("hwinfo --framebuffer", cancellationToken);
+		if (!hwinfo_proc) {
+			return false;
+		}
+		{
+			LineReader reader(hwinfo_proc);
+			char const* data;
+			size_t length;
+			//parses mode lines like "  Mode 0x0300: 640x400 (+640), 8 bits"
+			while (reader.readLine(data, length)) {
+				std::string row(data, length);
+				if (row.substr(0,7) == "  Mode "){
+					int beginOfResulution = row.find(':')+2;
+					int endOfResulution = row.find(' ', beginOfResulution);
+
+					int beginOfColorDepth = row.find(' ', endOfResulution+1)+1;
+					int endOfColorDepth = row.find(' ', beginOfColorDepth);
+
+					modes.push_back(
+						row.substr(beginOfResulution, endOfResulution-beginOfResulution)
+					  + "x"
+					  + row.substr(beginOfColorDepth, endOfColorDepth-beginOfColorDepth)
+					);
 				}
 			}
-			_isLoading = false;
 		}
+		return hwinfo.close() == 0 && !CancellationToken::isCancelled(cancellationToken);
+	}
+
+	static std::string readFile(std::string const& filePath) {
+		std::string content;
+		FILE* file = fopen(filePath.c_str(), "r");
+		if (file) {
+			char buffer[4096];
+			size_t length = 0;
+			while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+				content.append(buffer, length);
+			}
+			fclose(file);
+		}
+		return content;
+	}
+
+	static std::list<std::string> split(std::string const& rows) {
+		std::list<std::string> result;
+		size_t start = 0, end;
+		while ((end = rows.find('\n', start)) != std::string::npos) {
+			if (end != start) {
+				result.push_back(rows.substr(start, end - start));
+			}
+			start = end + 1;
+		}
+		if (start < rows.size()) {
+			result.push_back(rows.substr(start));
+		}
+		return result;
 	}
 
 };
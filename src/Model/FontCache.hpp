@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+#ifndef GRUB_CUSTOMIZER_FONTCACHE_INCLUDED
+#define GRUB_CUSTOMIZER_FONTCACHE_INCLUDED
+#include <string>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../lib/Helper.hpp"
+#include "../lib/Trait/LoggerAware.hpp"
+
+/**
+ * persistent storage of generated fonts (pf2). The fonts are stored by a digest of everything
+ * the result depends on: the content of the source font, the size and the version of mkfont.
+ * Cached fonts are hard linked to the requested path (copied if that isn't possible).
+ */
+class Model_FontCache : public Trait_LoggerAware
+{
+	private: std::string cacheDir;
+	private: std::map<std::string, std::string> mkfontVersions; // mkfont command → output of --version
+	private: std::map<std::string, std::string> fontDigests; // path, size and modification time → md5 of the content
+	private: std::mutex mutex;
+
+	public: Model_FontCache(std::string const& cacheDir = "/var/cache/grub-customizer/fonts")
+		: cacheDir(cacheDir)
+	{}
+
+	// fontFile must be readable at the given path, mkfontCmd is run to get its version.
+	// Returns an empty key (not cached) if the font can't be read
+	public: std::string getKey(std::string const& fontFile, int fontSize, std::string const& mkfontCmd)
+	{
+		std::string fontDigest = this->getFontDigest(fontFile);
+		if (fontDigest == "") {
+			return "";
+		}
+		return Helper::md5(fontDigest + "\n" + std::to_string(fontSize) + "\n" + this->getMkfontVersion(mkfontCmd));
+	}
+
+	// creates outputPath from the cache. Returns false if the font isn't cached
+	public: bool load(std::string const& key, std::string const& outputPath)
+	{
+		if (key == "") {
+			return false;
+		}
+		std::string cachePath = this->getFilePath(key);
+		struct stat fileProperties;
+		if (stat(cachePath.c_str(), &fileProperties) != 0 || fileProperties.st_size == 0) {
+			return false;
+		}
+		remove(outputPath.c_str()); // never write into an existing (maybe linked) file
+		if (link(cachePath.c_str(), outputPath.c_str()) != 0 && !Model_FontCache::copyFile(cachePath, outputPath)) {
+			this->log("cannot copy the cached font " + cachePath, Logger::ERROR);
+			remove(outputPath.c_str());
+			return false;
+		}
+		this->log("using cached font " + cachePath, Logger::INFO);
+		return true;
+	}
+
+	public: void save(std::string const& key, std::string const& generatedFile)
+	{
+		if (key == "") {
+			return;
+		}
+		mkdir(this->cacheDir.substr(0, this->cacheDir.rfind('/')).c_str(), 0755);
+		mkdir(this->cacheDir.c_str(), 0755);
+		std::string cachePath = this->getFilePath(key);
+		if (!Model_FontCache::copyFile(generatedFile, cachePath + ".new") || rename((cachePath + ".new").c_str(), cachePath.c_str()) != 0) {
+			this->log("cannot write the font cache " + cachePath, Logger::ERROR);
+			remove((cachePath + ".new").c_str());
+		}
+	}
+
+	// unlike FileSystem::copy, write errors (e.g. a full disk) are detected
+	private: static bool copyFile(std::string const& srcPath, std::string const& destPath)
+	{
+		struct stat fileProperties;
+		if (stat(srcPath.c_str(), &fileProperties) != 0) {
+			return false;
+		}
+		std::ifstream src(srcPath.c_str(), std::ios::binary);
+		std::ofstream dst(destPath.c_str(), std::ios::binary);
+		if (!src || !dst) {
+			return false;
+		}
+		if (fileProperties.st_size != 0 && !(dst << src.rdbuf())) {
+			return false;
+		}
+		dst.close();
+		return !dst.fail() && Model_FontCache::getFileSize(destPath) == fileProperties.st_size;
+	}
+
+	private: static off_t getFileSize(std::string const& path)
+	{
+		struct stat fileProperties;
+		return stat(path.c_str(), &fileProperties) == 0 ? fileProperties.st_size : -1;
+	}
+
+	private: std::string getFilePath(std::string const& key) const
+	{
+		return this->cacheDir + "/" + key + ".pf2";
+	}
+
+	private: std::string getFontDigest(std::string const& fontFile)
+	{
+		struct stat fileProperties;
+		if (stat(fontFile.c_str(), &fileProperties) != 0) {
+			return "";
+		}
+		std::string fileId = fontFile + "\n" + std::to_string(fileProperties.st_size) + "\n" + std::to_string(fileProperties.st_mtime);
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->fontDigests.find(fileId) == this->fontDigests.end()) {
+			std::string content;
+			FILE* file = fopen(fontFile.c_str(), "rb");
+			if (file == NULL) {
+				return "";
+			}
+			char buffer[65536];
+			size_t length = 0;
+			while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+				content.append(buffer, length);
+			}
+			bool readError = ferror(file);
+			fclose(file);
+			if (readError) {
+				return "";
+			}
+			this->fontDigests[fileId] = Helper::md5(content);
+		}
+		return this->fontDigests[fileId];
+	}
+
+	private: std::string getMkfontVersion(std::string const& mkfontCmd)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->mkfontVersions.find(mkfontCmd) == this->mkfontVersions.end()) {
+			std::string version;
+			FILE* proc = popen((mkfontCmd + " --version 2>&1").c_str(), "r");
+			if (proc) {
+				char buffer[256];
+				size_t length = 0;
+				while ((length = fread(buffer, 1, sizeof(buffer), proc)) > 0) {
+					version.append(buffer, length);
+				}
+				pclose(proc);
+			}
+			this->mkfontVersions[mkfontCmd] = version;
+		}
+		return this->mkfontVersions[mkfontCmd];
+	}
+};
+
+#endif
@@ -34,6 +34,9 @@
 #include <sstream>
 #include <iomanip>
 #include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
 #include <libintl.h>
 #include <unistd.h>
 #include <fstream>
@@ -46,11 +49,15 @@
 #include "../lib/Exception.hpp"
 #include "../lib/ArrayStructure.hpp"
 #include "../lib/Helper.hpp"
+#include "../lib/CancellationToken.hpp"
+#include "../lib/ChildProcess.hpp"
 #include <stack>
 #include <algorithm>
 #include <functional>
 #include "Env.hpp"
 #include "MountTable.hpp"
+#include "ParallelScriptRunner.hpp"
+#include "ListCfgSnapshot.hpp"
 #include "Proxylist.hpp"
 #include "ProxyScriptData.hpp"
 #include "Repository.hpp"
@@ -65,14 +72,16 @@ class Model_ListCfg :
 	private: double progress;
 	private: std::string progress_name;
 	private: int progress_pos, progress_max;
+	private: mutable std::mutex progressMutex; // progress is published by the worker thread and read by the ui
 	private: std::string errorLogFile;
 
 	private: Model_ScriptSourceMap scriptSourceMap;
 
 	public: Model_ListCfg() : error_proxy_not_found(false),
 	 progress(0),
-	 cancelThreadsRequested(false), verbose(true),
-	 errorLogFile(ERROR_LOG_FILE), ignoreLock(false), progress_pos(0), progress_max(0)
+	 verbose(true),
+	 errorLogFile(ERROR_LOG_FILE), ignoreLock(false), progress_pos(0), progress_max(0),
+	 loadedIncrementally(false), loading(false)
 	{}
 
 	public: void initLogger() override {
@@ -94,20 +103,21 @@ class Model_ListCfg :
 
 	public: bool verbose;
 	public: bool error_proxy_not_found;
-	public: void lock() {
+	// the call site (__FILE__, __LINE__) is recorded by the instrumented mutex
+	public: void lock(char const* file, int line) {
 		if (this->ignoreLock)
 			return;
 		if (this->mutex == NULL)
 			throw ConfigException("missing mutex", __FILE__, __LINE__);
-		this->mutex->lock();
+		this->mutex->lock(file, line);
 	}
 
-	public: bool lock_if_free() {
+	public: bool lock_if_free(char const* file, int line) {
 		if (this->ignoreLock)
 			return true;
 		if (this->mutex == NULL)
 			throw ConfigException("missing mutex", __FILE__, __LINE__);
-		return this->mutex->trylock();
+		return this->mutex->trylock(file, line);
 	}
 
 	public: void unlock() {
@@ -120,7 +130,24 @@ class Model_ListCfg :
 
 	public: bool ignoreLock;
 	
-	public: bool cancelThreadsRequested;
+	// token of the running load() - mkconfig gets killed and the output is ignored when it's cancelled
+	private: std::shared_ptr<CancellationToken> cancellationToken;
+
+	// true if the last call of load() patched the existing model (load(true)) instead of rebuilding it.
+	// While such a load is running the rules keep pointing to the previous entries until the reload is completed
+	public: bool loadedIncrementally;
+
+	// the proxies re-synced by the last incremental load - the rules of all other proxies are unchanged
+	public: std::list<std::shared_ptr<Model_Proxy>> reloadedProxies;
+
+	// toplevel entries of each script before the incremental load - used to detect changed scripts
+	private: std::map<std::shared_ptr<Model_Script>, std::list<std::shared_ptr<Model_Entry>>> previousEntries;
+
+	// the latest snapshot - replaced (never modified) using atomic_store
+	private: std::shared_ptr<Model_ListCfgSnapshot const> snapshot;
+
+	// true while load() is running - the model may be inconsistent between two locked sections
+	private: std::atomic<bool> loading;
 
 	public: bool createScriptForwarder(std::string const& scriptName) const
 	{
@@ -171,9 +198,62 @@ class Model_ListCfg :
 		}
 	}
 
-	public: void load(bool preserveConfig = false)
+	public: void load(bool preserveConfig = false, std::shared_ptr<CancellationToken> cancellationToken = nullptr)
+	{
+		this->lock(__FILE__, __LINE__);
+		this->publishSnapshot(); // the ui reads this snapshot until the next consistent state
+		this->loading = true;
+		this->unlock();
+		try {
+			this->loadConfig(preserveConfig, cancellationToken);
+		} catch (...) {
+			this->lock(__FILE__, __LINE__);
+			this->previousEntries.clear(); // the next load mustn't compare to these
+			this->unlock();
+			this->finishLoading();
+			throw;
+		}
+	}
+
+	/**
+	 * returns the current state of the proxies and rules. While loading, this is the snapshot published at the last
+	 * consistent state - otherwise a new one is created. Doesn't wait for the load thread.
+	 */
+	public: std::shared_ptr<Model_ListCfgSnapshot const> getSnapshot()
+	{
+		if (!this->loading && this->lock_if_free(__FILE__, __LINE__)) {
+			if (!this->loading) {
+				this->publishSnapshot();
+			}
+			this->unlock();
+		}
+		return std::atomic_load(&this->snapshot);
+	}
+
+	// must be called while the model is consistent and locked
+	private: void publishSnapshot()
+	{
+		std::shared_ptr<Model_ListCfgSnapshot const> snapshot = std::make_shared<Model_ListCfgSnapshot>(this->proxies, this->repository);
+		std::atomic_store(&this->snapshot, snapshot);
+	}
+
+	private: void finishLoading()
+	{
+		this->lock(__FILE__, __LINE__);
+		if (this->loading) {
+			this->publishSnapshot();
+			this->loading = false;
+		}
+		this->unlock();
+	}
+
+	private: void loadConfig(bool preserveConfig, std::shared_ptr<CancellationToken> cancellationToken)
 	{
+		this->cancellationToken = cancellationToken;
+		this->loadedIncrementally = preserveConfig;
+		this->reloadedProxies.clear();
 		if (!preserveConfig){
+			this->previousEntries.clear(); // left by an incremental load which has been aborted
 			send_new_load_progress(0);
 	
 			DIR* hGrubCfgDir = opendir(this->env->cfg_dir.c_str());
@@ -184,7 +264,7 @@ class Model_ListCfg :
 	
 			//load scripts
 			this->log("loading scripts…", Logger::EVENT);
-			this->lock();
+			this->lock(__FILE__, __LINE__);
 			repository.load(this->env->cfg_dir, false);
 			repository.load(this->env->cfg_dir+"/proxifiedScripts", true);
 			this->unlock();
@@ -193,7 +273,7 @@ class Model_ListCfg :
 		
 			//load proxies
 			this->log("loading proxies…", Logger::EVENT);
-			this->lock();
+			this->lock(__FILE__, __LINE__);
 			struct dirent *entry;
 			struct stat fileProperties;
 			while ((entry = readdir(hGrubCfgDir))){
@@ -227,7 +307,7 @@ class Model_ListCfg :
 	
 			//clean up proxy configuration
 			this->log("cleaning up proxy configuration…", Logger::EVENT);
-			this->lock();
+			this->lock(__FILE__, __LINE__);
 	
 			bool proxyRemoved = false;
 			do {
@@ -244,8 +324,12 @@ class Model_ListCfg :
 	
 			this->unlock();
 		} else {
-			this->lock();
-			proxies.unsync_all();
+			// keep the proxies synced with the current entries, readGeneratedFile compares them to the new ones
+			this->lock(__FILE__, __LINE__);
+			this->previousEntries.clear();
+			for (auto script : this->repository) {
+				this->previousEntries[script] = script->entries();
+			}
 			repository.deleteAllEntries();
 			this->unlock();
 		}
@@ -253,7 +337,7 @@ class Model_ListCfg :
 		//create proxifiedScript links & chmod other files
 		this->log("creating proxifiedScript links & chmodding other files…", Logger::EVENT);
 	
-		this->lock();
+		this->lock(__FILE__, __LINE__);
 		for (auto script : this->repository) {
 			if (script->isInScriptDir(env->cfg_dir)){
 				//createScriptForwarder & disable proxies
@@ -281,12 +365,30 @@ class Model_ListCfg :
 		}
 	
 		//run mkconfig
-		this->log("running " + this->env->mkconfig_cmd, Logger::EVENT);
-		FILE* mkconfigProc = popen((this->env->mkconfig_cmd + " 2> " + this->errorLogFile).c_str(), "r");
-		readGeneratedFile(mkconfigProc);
-		
-		int success = pclose(mkconfigProc);
-		if (success != 0 && !cancelThreadsRequested){
+		int success = 0;
+		if (this->env->parallelScriptExecution || this->env->scriptOutputCacheMode != Model_Env::OUTPUT_CACHE_DISABLED) {
+			this->log("running the scripts of " + this->env->cfg_dir + " in parallel", Logger::EVENT);
+			Model_ParallelScriptRunner scriptRunner(this->env, this->errorLogFile, cancellationToken);
+			if (this->env->scriptOutputCacheMode != Model_Env::OUTPUT_CACHE_DISABLED) {
+				scriptRunner.setOutputCache(
+					std::make_shared<Model_ScriptOutputCache>(this->env->cfg_dir + "/outputCache"),
+					this->env->scriptOutputCacheMode == Model_Env::OUTPUT_CACHE_VALIDATION
+				);
+			}
+			FILE* scriptOutput = scriptRunner.run();
+			readGeneratedFile(scriptOutput);
+			fclose(scriptOutput);
+		} else {
+			this->log("running " + this->env->mkconfig_cmd, Logger::EVENT);
+			ChildProcess mkconfig;
+			FILE* mkconfigProc = mkconfig.open(this->env->mkconfig_cmd + " 2> " + this->errorLogFile, cancellationToken);
+			if (mkconfigProc == NULL) {
+				throw CmdExecException("cannot start " + this->env->mkconfig_cmd, __FILE__, __LINE__);
+			}
+			readGeneratedFile(mkconfigProc);
+			success = mkconfig.close();
+		}
+		if (success != 0 && !CancellationToken::isCancelled(cancellationToken)){
 			throw CmdExecException("failed running " + this->env->mkconfig_cmd, __FILE__, __LINE__);
 		} else {
 			remove(errorLogFile.c_str()); //remove file, if everything was ok
@@ -294,8 +396,6 @@ class Model_ListCfg :
 		this->log("mkconfig successful completed", Logger::INFO);
 	
 		this->send_new_load_progress(0.9);
-	
-		mkconfigProc = NULL;
 		
 		this->env->useDirectBackgroundProps = this->repository.getScriptByName("debian_theme") == NULL;
 		if (this->env->useDirectBackgroundProps) {
@@ -307,7 +407,7 @@ class Model_ListCfg :
 		
 		//restore old configuration
 		this->log("restoring grub configuration", Logger::EVENT);
-		this->lock();
+		this->lock(__FILE__, __LINE__);
 		for (auto script : this->repository){
 			if (script->isInScriptDir(env->cfg_dir)){
 				//removeScriptForwarder & reset proxy permissions
@@ -334,6 +434,7 @@ class Model_ListCfg :
 					this->proxies.trash.push_back(proxy); // mark for deletion
 					this->proxies.erase(this->proxies.getIter(proxy));
 					foundInvalidScript = true;
+					this->loadedIncrementally = false;
 					invalidProxies += proxy->fileName + ",";
 					break;
 				}
@@ -348,9 +449,12 @@ class Model_ListCfg :
 		if (this->proxies.hasConflicts()) {
 			this->log("found conflicts - renumerating", Logger::INFO);
 			this->renumerate();
+			this->loadedIncrementally = false;
 		}
 	
-		this->log("loading completed", Logger::EVENT);
+		this->log(CancellationToken::isCancelled(cancellationToken) ? "loading cancelled" : "loading completed", Logger::EVENT);
+		this->cancellationToken = nullptr;
+		this->finishLoading();
 		send_new_load_progress(1);
 	}
 
@@ -558,37 +662,33 @@ class Model_ListCfg :
 		}
 	}
 
-	public: void readGeneratedFile(FILE* source, bool createScriptIfNotFound = false, bool createProxyIfNotFound = false)
+	public: void readGeneratedFile(FILE* sourceFile, bool createScriptIfNotFound = false, bool createProxyIfNotFound = false)
 	{
+		LineReader source(sourceFile);
 		Model_Entry_Row row;
 		std::shared_ptr<Model_Script> script = nullptr;
 		int i = 0;
 		bool inScript = false;
 		std::string plaintextBuffer = "";
 		int innerCount = 0;
+		bool syncPending = false; // true until the proxies of the current script have been synced with all of its entries
 		double progressbarScriptSpace = 0.7 / this->repository.size();
-		while (!cancelThreadsRequested && (row = Model_Entry_Row(source))){
-			std::string rowText = Helper::ltrim(row.text);
-			if (!inScript && rowText.substr(0,10) == ("### BEGIN ") && rowText.substr(rowText.length()-4,4) == " ###"){
-				this->lock();
-				if (script) {
-					if (plaintextBuffer != "" && !script->isModified()) {
-						auto newEntry = std::make_shared<Model_Entry>("#text", "", plaintextBuffer, Model_Entry::PLAINTEXT);
-						if (this->hasLogger()) {
-							newEntry->setLogger(this->getLogger());
-						}
-						script->entries().push_front(newEntry);
-					}
-					this->proxies.sync_all(true, true, script);
+		while (!CancellationToken::isCancelled(this->cancellationToken) && (row = Model_Entry_Row(source))){
+			Model_Entry_Row rowText = row.ltrim();
+			if (!inScript && rowText.startsWith("### BEGIN ") && rowText.endsWith(" ###")){
+				this->lock(__FILE__, __LINE__);
+				if (script && (syncPending || plaintextBuffer != "")) {
+					this->completeScriptLoad(script, plaintextBuffer);
 				}
 				plaintextBuffer = "";
-				std::string scriptName = rowText.substr(10, rowText.length()-14);
+				std::string scriptName = rowText.text().substr(10, rowText.length-14);
 				std::string prefix = this->env->cfg_dir_prefix;
 				std::string realScriptName = prefix+scriptName;
 				if (realScriptName.substr(0, (this->env->cfg_dir+"/LS_").length()) == this->env->cfg_dir+"/LS_"){
 					realScriptName = prefix+readScriptForwarder(realScriptName);
 				}
 				script = repository.getScriptByFilename(realScriptName, createScriptIfNotFound);
+				syncPending = script != nullptr;
 				if (createScriptIfNotFound && createProxyIfNotFound){ //for the compare-configuration
 					this->proxies.push_back(std::make_shared<Model_Proxy>(script));
 				}
@@ -597,50 +697,147 @@ class Model_ListCfg :
 					this->send_new_load_progress(0.1 + (progressbarScriptSpace * ++i + (progressbarScriptSpace/10*innerCount)), script->name, i, this->repository.size());
 				}
 				inScript = true;
-			} else if (inScript && rowText.substr(0,8) == ("### END ") && rowText.substr(rowText.length()-4,4) == " ###") {
+			} else if (inScript && rowText.startsWith("### END ") && rowText.endsWith(" ###")) {
 				inScript = false;
 				innerCount = 0;
-			} else if (script != nullptr && rowText.substr(0, 10) == "menuentry ") {
-				this->lock();
+				// the related proxies are synced once per script instead of after every single menuentry/submenu
+				if (script) {
+					this->lock(__FILE__, __LINE__);
+					this->completeScriptLoad(script, plaintextBuffer);
+					this->unlock();
+					plaintextBuffer = "";
+					syncPending = false;
+				}
+			} else if (script != nullptr && rowText.startsWith("menuentry ")) {
+				this->lock(__FILE__, __LINE__);
 				if (innerCount < 10) {
 					innerCount++;
 				}
 				auto newEntry = std::make_shared<Model_Entry>(source, row, this->getLogger());
 				if (!script->isModified()) {
-					script->entries().push_back(newEntry);
+					script->addEntry(newEntry);
 				}
-				this->proxies.sync_all(false, false, script);
+				syncPending = true;
 				this->unlock();
 				this->send_new_load_progress(0.1 + (progressbarScriptSpace * i + (progressbarScriptSpace/10*innerCount)), script->name, i, this->repository.size());
-			} else if (script != NULL && rowText.substr(0, 8) == "submenu ") {
-				this->lock();
+			} else if (script != NULL && rowText.startsWith("submenu ")) {
+				this->lock(__FILE__, __LINE__);
 				auto newEntry = std::make_shared<Model_Entry>(source, row, this->getLogger());
-				script->entries().push_back(newEntry);
-				this->proxies.sync_all(false, false, script);
+				script->addEntry(newEntry);
+				syncPending = true;
 				this->unlock();
 				this->send_new_load_progress(0.1 + (progressbarScriptSpace * i + (progressbarScriptSpace/10*innerCount)), script->name, i, this->repository.size());
 			} else if (inScript) { //Plaintext
-				plaintextBuffer += row.text + "\n";
+				plaintextBuffer.append(row.data, row.length);
+				plaintextBuffer += '\n';
 			}
 		}
-		this->lock();
-		if (script) {
-			if (plaintextBuffer != "" && !script->isModified()) {
-				auto newEntry = std::make_shared<Model_Entry>("#text", "", plaintextBuffer, Model_Entry::PLAINTEXT);
-				if (this->hasLogger()) {
-					newEntry->setLogger(this->getLogger());
-				}
-				script->entries().push_front(newEntry);
-			}
-			this->proxies.sync_all(true, true, script);
+		this->lock(__FILE__, __LINE__);
+		if (script && (syncPending || plaintextBuffer != "")) {
+			this->completeScriptLoad(script, plaintextBuffer);
 		}
 	
-		// sync all (including foreign entries)
-		this->proxies.sync_all(true, true, nullptr, this->repository.getScriptPathMap());
+		if (this->previousEntries.size()) {
+			this->applyReloadedEntries();
+		} else {
+			// sync all (including foreign entries)
+			this->proxies.sync_all(true, true, nullptr, this->repository.getScriptPathMap());
+		}
 	
 		this->unlock();
 	}
 
+	// adds the collected plaintext to the given script and syncs the proxies using it - must be called while locked
+	private: void completeScriptLoad(std::shared_ptr<Model_Script> script, std::string const& plaintextBuffer)
+	{
+		if (plaintextBuffer != "" && !script->isModified()) {
+			auto newEntry = std::make_shared<Model_Entry>("#text", "", plaintextBuffer, Model_Entry::PLAINTEXT);
+			if (this->hasLogger()) {
+				newEntry->setLogger(this->getLogger());
+			}
+			script->addEntry(newEntry, true);
+		}
+		if (this->previousEntries.empty()) {
+			this->proxies.sync_all(true, true, script);
+			if (this->loading) {
+				this->publishSnapshot();
+			}
+		}
+	}
+
+	// incremental load: restores the previous entry objects wherever the output didn't change
+	// and re-syncs only the proxies using entries of changed scripts - must be called while locked
+	private: void applyReloadedEntries()
+	{
+		std::set<std::shared_ptr<Model_Script>> changedScripts;
+		std::set<std::string> changedScriptPaths;
+		for (auto& previous : this->previousEntries) {
+			if (this->mergeReloadedEntries(previous.first, previous.second)) {
+				changedScripts.insert(previous.first);
+				changedScriptPaths.insert(previous.first->fileName);
+			}
+		}
+		this->previousEntries.clear();
+
+		auto scriptMap = this->repository.getScriptPathMap();
+		for (auto proxy : this->proxies) {
+			if (proxy->dataSource == nullptr) {
+				continue;
+			}
+			bool affected = changedScripts.count(proxy->dataSource) != 0;
+			if (!affected) {
+				for (auto foreignRule : proxy->getForeignRules()) {
+					if (changedScriptPaths.count(foreignRule->__sourceScriptPath)) {
+						affected = true;
+						break;
+					}
+				}
+			}
+			if (affected) {
+				this->log("re-syncing proxy " + proxy->fileName, Logger::INFO);
+				proxy->unsync();
+				proxy->sync(true, true);
+				proxy->sync(true, true, scriptMap);
+				this->reloadedProxies.push_back(proxy);
+			}
+		}
+		this->log(
+			"incremental load: " + std::to_string(changedScripts.size()) + " script(s) changed, "
+				+ std::to_string(this->reloadedProxies.size()) + " proxies re-synced",
+			Logger::INFO
+		);
+	}
+
+	// replaces the new toplevel entries of the script by equal entries of the previous output - returns true if the output differs
+	private: bool mergeReloadedEntries(std::shared_ptr<Model_Script> script, std::list<std::shared_ptr<Model_Entry>> const& previousEntries)
+	{
+		std::map<std::string, std::list<std::shared_ptr<Model_Entry>>> unusedEntries;
+		for (auto entry : previousEntries) {
+			unusedEntries[entry->name].push_back(entry);
+		}
+
+		bool changed = script->entries().size() != previousEntries.size();
+		auto previousIter = previousEntries.begin();
+		for (auto& entry : script->entries()) {
+			auto& candidates = unusedEntries[entry->name];
+			for (auto candidateIter = candidates.begin(); candidateIter != candidates.end(); candidateIter++) {
+				if (*candidateIter == entry || (*candidateIter)->equals(*entry)) {
+					entry = *candidateIter;
+					candidates.erase(candidateIter);
+					break;
+				}
+			}
+			if (!changed && entry != *previousIter) {
+				changed = true;
+			}
+			if (previousIter != previousEntries.end()) {
+				previousIter++;
+			}
+		}
+		script->invalidateIndex();
+		return changed;
+	}
+
 	public: std::map<std::shared_ptr<Model_Entry>, std::shared_ptr<Model_Script>> getEntrySources(
 		std::shared_ptr<Model_Proxy> proxy,
 		std::shared_ptr<Model_Rule> parent = nullptr
@@ -683,10 +880,13 @@ class Model_ListCfg :
 	public: void send_new_load_progress(double newProgress, std::string scriptName = "", int current = 0, int max = 0)
 	{
 		if (this->onLoadStateChange){
-			this->progress = newProgress;
-			this->progress_name = scriptName;
-			this->progress_pos = current;
-			this->progress_max = max;
+			{
+				std::lock_guard<std::mutex> lock(this->progressMutex);
+				this->progress = newProgress;
+				this->progress_name = scriptName;
+				this->progress_pos = current;
+				this->progress_max = max;
+			}
 			this->onLoadStateChange();
 		} else if (this->verbose) {
 			this->log("cannot show updated load progress - no event handler assigned!", Logger::ERROR);
@@ -696,21 +896,19 @@ class Model_ListCfg :
 	public: void send_new_save_progress(double newProgress)
 	{
 		if (this->onSaveStateChange){
-			this->progress = newProgress;
+			{
+				std::lock_guard<std::mutex> lock(this->progressMutex);
+				this->progress = newProgress;
+			}
 			this->onSaveStateChange();
 		} else if (this->verbose) {
 			this->log("cannot show updated save progress - no event handler assigned!", Logger::ERROR);
 		}
 	}
 
-	public: void cancelThreads()
-	{
-		cancelThreadsRequested = true;
-	}
-
 	public: void reset()
 	{
-		this->lock();
+		this->lock(__FILE__, __LINE__);
 		this->repository.clear();
 		this->repository.trash.clear();
 		this->proxies.clear();
@@ -720,22 +918,26 @@ class Model_ListCfg :
 
 	public: double getProgress() const
 	{
-		return progress;
+		std::lock_guard<std::mutex> lock(this->progressMutex);
+		return this->progress;
 	}
 
 	public: std::string getProgress_name() const
 	{
-		return progress_name;
+		std::lock_guard<std::mutex> lock(this->progressMutex);
+		return this->progress_name;
 	}
 
 	public: int getProgress_pos() const
 	{
-		return progress_pos;
+		std::lock_guard<std::mutex> lock(this->progressMutex);
+		return this->progress_pos;
 	}
 
 	public: int getProgress_max() const
 	{
-		return progress_max;
+		std::lock_guard<std::mutex> lock(this->progressMutex);
+		return this->progress_max;
 	}
 
 	public: void renumerate(bool favorDefaultOrder = true)
@@ -802,6 +1004,8 @@ class Model_ListCfg :
 				std::string fname = entry->d_name;
 				if ((fname.length() >= 4 && fname.substr(0,3) == "LS_") || fname.substr(0,3) == "PS_" || fname.substr(0,3) == "DS_")
 					return false;
+				if (fname == Model_ParallelScriptRunner::getEnvironmentScriptName())
+					return false;
 			}
 			closedir(hGrubCfgDir);
 		}
@@ -820,7 +1024,10 @@ class Model_ListCfg :
 			std::list<std::string> proxyscripts;
 			while ((entry = readdir(hGrubCfgDir))){
 				std::string fname = entry->d_name;
-				if (fname.length() >= 4){
+				if (fname == Model_ParallelScriptRunner::getEnvironmentScriptName()) {
+					this->log("deleting " + fname, Logger::EVENT);
+					unlink((this->env->cfg_dir+"/"+fname).c_str());
+				} else if (fname.length() >= 4){
 					if (fname.substr(0,3) == "LS_")
 						lsfiles.push_back(fname);
 					else if (fname.substr(0,3) == "DS_")
@@ -994,57 +1201,6 @@ class Model_ListCfg :
 		}
 	}
 
-
-	public: std::list<std::shared_ptr<Model_Rule>> getRemovedEntries(
-		std::shared_ptr<Model_Entry> parent = nullptr,
-		bool ignorePlaceholders = false
-	) {
-		std::list<std::shared_ptr<Model_Rule>> result;
-		if (parent == nullptr) {
-			for (auto script : this->repository) {
-				auto subResult = this->getRemovedEntries(script->root, ignorePlaceholders);
-				result.insert(result.end(), subResult.begin(), subResult.end());
-			}
-		} else {
-			if (parent->type == Model_Entry::SUBMENU || parent->type == Model_Entry::SCRIPT_ROOT) {
-				for (auto entry : parent->subEntries) {
-					auto subResult = this->getRemovedEntries(entry, ignorePlaceholders);
-					std::shared_ptr<Model_Rule> currentSubmenu = nullptr;
-					if (subResult.size()) {
-						auto submenu = std::make_shared<Model_Rule>(Model_Rule::SUBMENU, std::list<std::string>(), entry->name, true);
-						submenu->subRules = subResult;
-						submenu->dataSource = entry;
-						result.push_back(submenu);
-						currentSubmenu = result.back();
-					}
-	
-					if ((entry->type == Model_Entry::MENUENTRY || !ignorePlaceholders) && !this->proxies.getVisibleRuleForEntry(entry)) {
-						Model_Rule::RuleType ruleType = Model_Rule::NORMAL;
-						switch (entry->type) {
-						case Model_Entry::MENUENTRY:
-							ruleType = Model_Rule::NORMAL;
-							break;
-						case Model_Entry::PLAINTEXT:
-							ruleType = Model_Rule::PLAINTEXT;
-							break;
-						case Model_Entry::SUBMENU:
-							ruleType = Model_Rule::OTHER_ENTRIES_PLACEHOLDER;
-							break;
-						}
-						auto newRule = std::make_shared<Model_Rule>(ruleType, std::list<std::string>(), entry->name, true);
-						newRule->dataSource = entry;
-						if (currentSubmenu) {
-							currentSubmenu->subRules.push_front(newRule);
-						} else {
-							result.push_back(newRule);
-						}
-					}
-				}
-			}
-		}
-		return result;
-	}
-
 	public: std::shared_ptr<Model_Rule> addEntry(
 		std::shared_ptr<Model_Entry> entry,
 		bool insertAsOtherEntriesPlaceholder = false
@@ -1215,10 +1371,10 @@ class Model_ListCfg :
 			if (oldScript->isCustomScript && newScript->isCustomScript && oldScript->entries().size()) {
 				for (auto entry : oldScript->entries()) {
 					if (entry->type == Model_Entry::PLAINTEXT && newScript->getPlaintextEntry()) {
-						newScript->getPlaintextEntry()->content = entry->content; // copy plaintext instead of adding another entry
+						newScript->getPlaintextEntry()->setContent(entry->content); // copy plaintext instead of adding another entry
 						newScript->getPlaintextEntry()->isModified = true;
 					} else {
-						newScript->entries().push_back(entry);
+						newScript->addEntry(entry);
 						newScript->entries().back()->isModified = true;
 					}
 				}
@@ -1335,7 +1491,7 @@ class Model_ListCfg :
 			result["env"] = ArrayStructureItem(NULL);
 		}
 		result["ignoreLock"] = this->ignoreLock;
-		result["cancelThreadsRequested"] = this->cancelThreadsRequested;
+		result["cancelled"] = CancellationToken::isCancelled(this->cancellationToken);
 		return result;
 	}
 };
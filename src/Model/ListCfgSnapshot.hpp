@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef GRUB_CUSTOMIZER_LISTCFGSNAPSHOT_INCLUDED
+#define GRUB_CUSTOMIZER_LISTCFGSNAPSHOT_INCLUDED
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <memory>
+#include "Entry.hpp"
+#include "Rule.hpp"
+#include "Proxylist.hpp"
+#include "Repository.hpp"
+
+struct Model_ListCfgSnapshot_Rule {
+	std::shared_ptr<Model_Rule> rule; // identifies the rule - its members must not be read, they may be changed by the loader
+	Model_Rule::RuleType type;
+	std::string outputName;
+	bool isVisible;
+	std::shared_ptr<Model_Entry> dataSource; // entries aren't changed while loading
+	std::string scriptName; // script containing the data source
+	std::list<std::shared_ptr<Model_ListCfgSnapshot_Rule const>> subRules;
+};
+
+struct Model_ListCfgSnapshot_Proxy {
+	std::shared_ptr<Model_Proxy> proxy; // identifies the proxy - its members must not be read
+	std::string scriptName;
+	bool isExecutable;
+	bool isModified;
+	std::list<std::shared_ptr<Model_ListCfgSnapshot_Rule const>> rules;
+};
+
+/**
+ * immutable copy of the proxies and rules at a consistent state of Model_ListCfg. The ui reads snapshots
+ * instead of the model, so it never has to wait for the load thread (and the load thread never waits for the ui).
+ */
+class Model_ListCfgSnapshot
+{
+	public: std::list<Model_ListCfgSnapshot_Proxy> proxies;
+
+	private: std::list<std::pair<std::string, std::list<std::shared_ptr<Model_Entry>>>> scripts; // name and toplevel entries
+	private: std::map<Model_Entry const*, std::string> entryScriptNames;
+	private: std::set<Model_Entry const*> visibleEntries; // entries used by visible rules of executable proxies
+
+	// must be called while the model is consistent and locked
+	public: Model_ListCfgSnapshot(Model_Proxylist const& proxies, Model_Repository const& repository)
+	{
+		for (auto& script : repository) {
+			this->scripts.push_back(std::make_pair(script->name, script->entries()));
+			this->entryScriptNames[script->root.get()] = script->name; // data source of the toplevel placeholder
+			this->indexEntries(script->entries(), script->name);
+		}
+		for (auto& proxy : proxies) {
+			Model_ListCfgSnapshot_Proxy proxySnapshot;
+			proxySnapshot.proxy = proxy;
+			proxySnapshot.scriptName = proxy->dataSource ? proxy->dataSource->name : "?";
+			proxySnapshot.isExecutable = proxy->isExecutable();
+			proxySnapshot.isModified = proxy->dataSource && proxy->isModified();
+			proxySnapshot.rules = this->copyRules(proxy->rules, proxySnapshot.isExecutable);
+			this->proxies.push_back(proxySnapshot);
+		}
+	}
+
+	// empty string if the entry doesn't belong to a script
+	public: std::string getScriptName(std::shared_ptr<Model_Entry> const& entry) const
+	{
+		auto scriptName = this->entryScriptNames.find(entry.get());
+		return scriptName != this->entryScriptNames.end() ? scriptName->second : "";
+	}
+
+	public: std::list<std::string> getToplevelEntryTitles() const
+	{
+		std::list<std::string> result;
+		for (auto& proxy : this->proxies) {
+			if (proxy.isExecutable) {
+				for (auto& rule : proxy.rules) {
+					if (rule->isVisible && rule->type == Model_Rule::NORMAL) {
+						result.push_back(rule->outputName);
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	// entries not used by any visible rule - as rules which can be shown by the trash view
+	public: std::list<std::shared_ptr<Model_Rule>> getRemovedEntries(bool ignorePlaceholders = false) const
+	{
+		std::list<std::shared_ptr<Model_Rule>> result;
+		for (auto& script : this->scripts) {
+			auto subResult = this->getRemovedEntries(script.second, ignorePlaceholders);
+			result.insert(result.end(), subResult.begin(), subResult.end());
+		}
+		return result;
+	}
+
+	private: std::list<std::shared_ptr<Model_Rule>> getRemovedEntries(
+		std::list<std::shared_ptr<Model_Entry>> const& entries,
+		bool ignorePlaceholders
+	) const {
+		std::list<std::shared_ptr<Model_Rule>> result;
+		for (auto& entry : entries) {
+			std::shared_ptr<Model_Rule> currentSubmenu = nullptr;
+			if (entry->type == Model_Entry::SUBMENU) {
+				auto subResult = this->getRemovedEntries(entry->subEntries, ignorePlaceholders);
+				if (subResult.size()) {
+					auto submenu = std::make_shared<Model_Rule>(Model_Rule::SUBMENU, std::list<std::string>(), entry->name, true);
+					submenu->subRules = subResult;
+					submenu->dataSource = entry;
+					result.push_back(submenu);
+					currentSubmenu = result.back();
+				}
+			}
+
+			if ((entry->type == Model_Entry::MENUENTRY || !ignorePlaceholders) && !this->visibleEntries.count(entry.get())) {
+				Model_Rule::RuleType ruleType = Model_Rule::NORMAL;
+				switch (entry->type) {
+				case Model_Entry::MENUENTRY:
+					ruleType = Model_Rule::NORMAL;
+					break;
+				case Model_Entry::PLAINTEXT:
+					ruleType = Model_Rule::PLAINTEXT;
+					break;
+				case Model_Entry::SUBMENU:
+					ruleType = Model_Rule::OTHER_ENTRIES_PLACEHOLDER;
+					break;
+				}
+				auto newRule = std::make_shared<Model_Rule>(ruleType, std::list<std::string>(), entry->name, true);
+				newRule->dataSource = entry;
+				if (currentSubmenu) {
+					currentSubmenu->subRules.push_front(newRule);
+				} else {
+					result.push_back(newRule);
+				}
+			}
+		}
+		return result;
+	}
+
+	private: void indexEntries(std::list<std::shared_ptr<Model_Entry>> const& entries, std::string const& scriptName)
+	{
+		for (auto& entry : entries) {
+			this->entryScriptNames[entry.get()] = scriptName;
+			this->indexEntries(entry->subEntries, scriptName);
+		}
+	}
+
+	private: std::list<std::shared_ptr<Model_ListCfgSnapshot_Rule const>> copyRules(
+		std::list<std::shared_ptr<Model_Rule>> const& rules,
+		bool proxyIsExecutable
+	) {
+		std::list<std::shared_ptr<Model_ListCfgSnapshot_Rule const>> result;
+		for (auto& rule : rules) {
+			auto ruleSnapshot = std::make_shared<Model_ListCfgSnapshot_Rule>();
+			ruleSnapshot->rule = rule;
+			ruleSnapshot->type = rule->type;
+			ruleSnapshot->outputName = rule->outputName;
+			ruleSnapshot->isVisible = rule->isVisible;
+			ruleSnapshot->dataSource = rule->dataSource;
+			if (rule->dataSource) {
+				ruleSnapshot->scriptName = this->getScriptName(rule->dataSource);
+				if (rule->isVisible && proxyIsExecutable) {
+					this->visibleEntries.insert(rule->dataSource.get());
+				}
+			}
+			ruleSnapshot->subRules = this->copyRules(rule->subRules, proxyIsExecutable);
+			result.push_back(ruleSnapshot);
+		}
+		return result;
+	}
+};
+
+#endif
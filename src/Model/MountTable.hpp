@@ -27,11 +27,18 @@
 #ifndef MOUNT_TABLE_INCLUDED
 #define MOUNT_TABLE_INCLUDED
 #include <list>
+#include <map>
+#include <unordered_map>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <cstdlib>
+#include <exception>
+#include <thread>
+#include <vector>
 
 #include "../lib/Exception.hpp"
+#include "../lib/Mount.hpp"
 #include "../lib/Trait/LoggerAware.hpp"
 #include "../lib/Helper.hpp"
 
@@ -39,6 +46,7 @@
 struct Model_MountTable_Mountpoint {
 	std::string device, mountpoint, fileSystem, options, dump, pass;
 	bool isMounted;
+	int mountId, parentMountId; // only set if loaded from mountinfo, -1 otherwise
 	bool isValid(std::string const& prefix = "", bool isRoot = false) const {
 		return device != "" && (mountpoint != prefix || isRoot) && mountpoint != prefix+"none" && fileSystem != "" && options != "" && dump != "" && pass != "";
 	}
@@ -48,19 +56,24 @@ struct Model_MountTable_Mountpoint {
 	}
 
 	Model_MountTable_Mountpoint(std::string const& mountpoint = "", bool isMounted = false)
-		: isMounted(isMounted), mountpoint(mountpoint)
+		: isMounted(isMounted), mountpoint(mountpoint), mountId(-1), parentMountId(-1)
 	{}
 	
 	Model_MountTable_Mountpoint(std::string const& device, std::string const& mountpoint, std::string const& options, bool isMounted = false)
-		: device(device), mountpoint(mountpoint), isMounted(isMounted), options(options)
+		: device(device), mountpoint(mountpoint), isMounted(isMounted), options(options), mountId(-1), parentMountId(-1)
 	{
 	}
 
 	void mount() {
 		if (!isMounted){
-			int res = system(("mount '"+device+"' '"+mountpoint+"'"+(options != "" ? " -o '"+options+"'" : "")).c_str());
-			if (res != 0)
-				throw MountException("mount failed", __FILE__, __LINE__);
+			try {
+				Mount::mount(device, mountpoint, fileSystem, options);
+			} catch (MountException const& e) {
+				// fall back to mount(8) - it supports helpers, loop devices and detects filesystems by content
+				int res = system(("mount '"+device+"' '"+mountpoint+"'"+(options != "" ? " -o '"+options+"'" : "")).c_str());
+				if (res != 0)
+					throw MountException("mount failed: " + e.getMessage(), __FILE__, __LINE__);
+			}
 	
 			this->isMounted = true;
 		}
@@ -68,9 +81,13 @@ struct Model_MountTable_Mountpoint {
 
 	void umount() {
 		if (isMounted){
-			int res = system(("umount '"+mountpoint+"'").c_str());
-			if (res != 0)
-				throw UMountException("umount failed", __FILE__, __LINE__);
+			try {
+				Mount::umount(mountpoint);
+			} catch (UMountException const& e) {
+				int res = system(("umount '"+mountpoint+"'").c_str());
+				if (res != 0)
+					throw UMountException("umount failed: " + e.getMessage(), __FILE__, __LINE__);
+			}
 	
 			this->isMounted = false;
 		}
@@ -85,6 +102,11 @@ struct Model_MountTable_Mountpoint {
 class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public Trait_LoggerAware {
 	private: bool loaded;
 
+	// lookup indexes - must be updated on each change of the list
+	private: std::unordered_map<std::string, Model_MountTable::iterator> mountpointIndex;
+	private: std::unordered_map<std::string, std::list<Model_MountTable::iterator>> deviceIndex; // in list order
+	private: std::map<std::string, Model_MountTable::iterator> sortedMountpoints; // for longest prefix lookups
+
 	public: Model_MountTable(FILE* source, std::string const& prefix, bool default_isMounted_flag)
 		: loaded(false)
 	{
@@ -98,6 +120,21 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 
 	public: Model_MountTable() : loaded(false) {}
 
+	// the indexes point into the list, so they can't be copied
+	public: Model_MountTable(Model_MountTable const& other)
+		: std::list<Model_MountTable_Mountpoint>(other), Trait_LoggerAware(other), loaded(other.loaded)
+	{
+		this->rebuildIndex();
+	}
+
+	public: Model_MountTable& operator=(Model_MountTable const& other) {
+		std::list<Model_MountTable_Mountpoint>::operator=(other);
+		Trait_LoggerAware::operator=(other);
+		this->loaded = other.loaded;
+		this->rebuildIndex();
+		return *this;
+	}
+
 	public: void sync(Model_MountTable const& mtab) {
 		for (Model_MountTable::const_iterator iter = mtab.begin(); iter != mtab.end(); iter++){
 			this->add(*iter);
@@ -112,56 +149,152 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 		return isLoaded();
 	}
 
+	// reads fstab/mtab formatted data
 	public: void loadData(FILE* source, std::string const& prefix, bool default_isMounted_flag = false) {
-		int c;
-		int rowEntryPos = 0;
-		bool isComment = false;
-		bool isBeginOfRow = true;
-		char previousChar = 0;
-		Model_MountTable_Mountpoint newMp(prefix, default_isMounted_flag);
-		while ((c = fgetc(source)) != EOF){
-			if (isBeginOfRow && c == '#') {
-				isComment = true;
-			} else if (c == '\n'){
-				this->add(prefix, newMp);
-
-				newMp = Model_MountTable_Mountpoint(prefix, default_isMounted_flag);
-				rowEntryPos = 0;
-				isBeginOfRow = true;
-				isComment = false;
-			} else if (!isComment) {
-				if (c == ' ' || c == '\t'){
-					if (previousChar != ' ' && previousChar != '\t')
-						rowEntryPos++;
-					isBeginOfRow = false;
-				} else {
-					switch (rowEntryPos){
-						case 0:	newMp.device += char(c); break;
-						case 1: newMp.mountpoint += char(c); break;
-						case 2: newMp.fileSystem += char(c); break;
-						case 3: newMp.options += char(c); break;
-						case 4: newMp.dump += char(c); break;
-						case 5: newMp.pass += char(c); break;
-					}
-					isBeginOfRow = false;
+		char* line = NULL;
+		size_t lineBufferSize = 0;
+		ssize_t lineLength;
+		while ((lineLength = getline(&line, &lineBufferSize, source)) != -1) {
+			if (lineLength && line[lineLength - 1] == '\n') {
+				line[--lineLength] = '\0';
+			}
+			if (line[0] == '#') {
+				continue;
+			}
+			std::string* fields[6];
+			Model_MountTable_Mountpoint newMp(prefix, default_isMounted_flag);
+			fields[0] = &newMp.device;
+			fields[1] = &newMp.mountpoint;
+			fields[2] = &newMp.fileSystem;
+			fields[3] = &newMp.options;
+			fields[4] = &newMp.dump;
+			fields[5] = &newMp.pass;
+
+			// each run of whitespace starts the next field - including leading whitespace
+			char const* pos = line;
+			char const* lineEnd = line + lineLength;
+			for (int fieldIndex = 0; pos != lineEnd && fieldIndex < 6; fieldIndex++) {
+				size_t length = strcspn(pos, " \t");
+				fields[fieldIndex]->append(pos, length);
+				pos += length;
+				pos += strspn(pos, " \t");
+			}
+			this->add(prefix, newMp);
+		}
+		free(line);
+
+		loaded = true;
+	}
+
+	/**
+	 * reads /proc/<pid>/mountinfo formatted data:
+	 * 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+	 * the mount ids are available in the resulting entries
+	 */
+	public: void loadMountInfo(FILE* source, std::string const& prefix = "", bool default_isMounted_flag = true) {
+		char* line = NULL;
+		size_t lineBufferSize = 0;
+		ssize_t lineLength;
+		while ((lineLength = getline(&line, &lineBufferSize, source)) != -1) {
+			if (lineLength && line[lineLength - 1] == '\n') {
+				line[--lineLength] = '\0';
+			}
+			std::list<std::string> fields = Model_MountTable::splitMountInfoLine(line, lineLength);
+			if (fields.size() < 10) {
+				continue; // invalid line
+			}
+			Model_MountTable_Mountpoint newMp(prefix, default_isMounted_flag);
+			auto field = fields.begin();
+			newMp.mountId = atoi((field++)->c_str());
+			newMp.parentMountId = atoi((field++)->c_str());
+			field++; // major:minor
+			field++; // root of the mount
+			newMp.mountpoint += *field++;
+			newMp.options = *field++;
+			while (field != fields.end() && *field != "-") {
+				field++; // optional fields
+			}
+			if (field == fields.end() || std::next(field) == fields.end() || std::next(field, 2) == fields.end()) {
+				continue;
+			}
+			field++;
+			newMp.fileSystem = *field++;
+			newMp.device = *field++;
+			// append the super options like /proc/mounts does - without the leading rw/ro which is already included
+			if (field != fields.end()) {
+				size_t firstSeparator = field->find(',');
+				if (firstSeparator != std::string::npos) {
+					newMp.options += field->substr(firstSeparator);
 				}
 			}
-			previousChar = c;
+			newMp.dump = "0";
+			newMp.pass = "0";
+			this->add(prefix, newMp);
 		}
-		this->add(prefix, newMp);
+		free(line);
 
 		loaded = true;
 	}
 
+	// loads the currently mounted filesystems - from /proc/self/mountinfo if available
+	public: void loadMounted() {
+		FILE* mountInfoFile = fopen("/proc/self/mountinfo", "r");
+		if (mountInfoFile) {
+			this->loadMountInfo(mountInfoFile, "", true);
+			fclose(mountInfoFile);
+			return;
+		}
+		FILE* mtabFile = fopen("/etc/mtab", "r");
+		if (mtabFile) {
+			this->loadData(mtabFile, "", true);
+			fclose(mtabFile);
+		}
+	}
+
+	private: static std::list<std::string> splitMountInfoLine(char const* line, size_t lineLength) {
+		std::list<std::string> result;
+		char const* pos = line;
+		char const* lineEnd = line + lineLength;
+		while (pos != lineEnd) {
+			size_t length = strcspn(pos, " ");
+			if (length) {
+				result.push_back(std::string(pos, length));
+			}
+			pos += length;
+			pos += strspn(pos, " ");
+		}
+		return result;
+	}
+
+	// replaces octal escapes like \040 (space) as used by fstab, mtab and mountinfo
+	private: static void decode(std::string& str) {
+		size_t pos = str.find('\\');
+		if (pos == std::string::npos) {
+			return;
+		}
+		std::string result = str.substr(0, pos);
+		while (pos < str.length()) {
+			if (str[pos] == '\\' && pos + 3 < str.length()
+				&& str[pos + 1] >= '0' && str[pos + 1] <= '3'
+				&& str[pos + 2] >= '0' && str[pos + 2] <= '7'
+				&& str[pos + 3] >= '0' && str[pos + 3] <= '7') {
+				result += char((str[pos + 1] - '0') * 64 + (str[pos + 2] - '0') * 8 + (str[pos + 3] - '0'));
+				pos += 4;
+			} else {
+				result += str[pos++];
+			}
+		}
+		str = result;
+	}
+
 	private: void add(std::string const& prefix, Model_MountTable_Mountpoint& newMp)
 	{
-		// decode
-		newMp.device     = Helper::str_replace("\\040", " ", newMp.device);
-		newMp.mountpoint = Helper::str_replace("\\040", " ", newMp.mountpoint);
-		newMp.fileSystem = Helper::str_replace("\\040", " ", newMp.fileSystem);
-		newMp.options    = Helper::str_replace("\\040", " ", newMp.options);
-		newMp.dump       = Helper::str_replace("\\040", " ", newMp.dump);
-		newMp.pass       = Helper::str_replace("\\040", " ", newMp.pass);
+		Model_MountTable::decode(newMp.device);
+		Model_MountTable::decode(newMp.mountpoint);
+		Model_MountTable::decode(newMp.fileSystem);
+		Model_MountTable::decode(newMp.options);
+		Model_MountTable::decode(newMp.dump);
+		Model_MountTable::decode(newMp.pass);
 
 		bool isRoot = newMp.mountpoint == prefix + "/";
 
@@ -170,8 +303,7 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 		}
 
 		if (newMp.isValid(prefix, isRoot)){
-			this->remove(newMp);
-			this->push_back(newMp);
+			this->add(newMp);
 		}
 	}
 
@@ -179,12 +311,8 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 		FILE* fstabFile = fopen((rootDirectory+"/etc/fstab").c_str(), "r");
 		if (fstabFile != NULL){
 			this->loadData(fstabFile, rootDirectory);
-			Model_MountTable mtab;
-			FILE* mtabfile = fopen("/etc/mtab", "r"); //use global mtab - the local one is unmanaged
-			if (mtabfile){
-				mtab = Model_MountTable(mtabfile, "", true);
-				fclose(mtabfile);
-			}
+			Model_MountTable mtab; //use global mount table - the local one is unmanaged
+			mtab.loadMounted();
 			this->sync(mtab);
 			fclose(fstabFile);
 		}
@@ -193,9 +321,9 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 	public: void clear(std::string const& prefix) {
 		Model_MountTable::iterator iter = this->begin();
 		while (iter != this->end()){
-			if (iter->mountpoint.substr(0, prefix.length()) == prefix){
-				this->erase(iter);
-				iter = this->begin();
+			if (iter->mountpoint.compare(0, prefix.length(), prefix) == 0){
+				this->removeFromIndex(iter);
+				iter = this->erase(iter);
 			}
 			else
 				iter++;
@@ -204,17 +332,17 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 	}
 
 	public: Model_MountTable_Mountpoint getEntryByMountpoint(std::string const& mountPoint) const {
-		for (std::list<Model_MountTable_Mountpoint>::const_iterator iter = this->begin(); iter != this->end(); iter++){
-			if (iter->mountpoint == mountPoint)
-				return *iter;
+		auto indexEntry = this->mountpointIndex.find(mountPoint);
+		if (indexEntry != this->mountpointIndex.end()) {
+			return *indexEntry->second;
 		}
 		return Model_MountTable_Mountpoint();
 	}
 
 	public: Model_MountTable_Mountpoint& getEntryRefByMountpoint(std::string const& mountPoint) {
-		for (std::list<Model_MountTable_Mountpoint>::iterator iter = this->begin(); iter != this->end(); iter++){
-			if (iter->mountpoint == mountPoint)
-				return *iter;
+		auto indexEntry = this->mountpointIndex.find(mountPoint);
+		if (indexEntry != this->mountpointIndex.end()) {
+			return *indexEntry->second;
 		}
 		throw MountpointNotFoundException("mountpoint not found", __FILE__, __LINE__);
 	}
@@ -222,23 +350,44 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 	public: Model_MountTable_Mountpoint& add(Model_MountTable_Mountpoint const& mpToAdd) {
 		this->remove(mpToAdd); //remove existing mountpoints with the same directory
 		this->push_back(mpToAdd);
+		this->addToIndex(std::prev(this->end()));
 		return this->back();
 	}
 
 	public: void remove(Model_MountTable_Mountpoint const& mountpoint) {
-		for (std::list<Model_MountTable_Mountpoint>::iterator iter = this->begin(); iter != this->end(); iter++){
-			if (iter->mountpoint == mountpoint.mountpoint){
-				this->erase(iter);
-				break;
-			}
+		auto indexEntry = this->mountpointIndex.find(mountpoint.mountpoint);
+		if (indexEntry != this->mountpointIndex.end()) {
+			Model_MountTable::iterator iter = indexEntry->second;
+			this->removeFromIndex(iter);
+			this->erase(iter);
 		}
 	}
 
 	public: void umountAll(std::string const& prefix) {
-		for (Model_MountTable::reverse_iterator iter = this->rbegin(); iter != this->rend(); iter++){
+		std::vector<Model_MountTable_Mountpoint*> remaining; // in list order
+		for (Model_MountTable::iterator iter = this->begin(); iter != this->end(); iter++){
 			if (iter->mountpoint.substr(0, prefix.length()) == prefix && iter->mountpoint != prefix && iter->isMounted){
-				iter->umount();
+				remaining.push_back(&*iter);
+			}
+		}
+
+		// nested mountpoints are umounted in reverse list order, independent ones at the same time
+		while (remaining.size()) {
+			std::list<Model_MountTable_Mountpoint*> independentMountpoints;
+			std::vector<Model_MountTable_Mountpoint*> blockedMountpoints;
+			for (size_t i = 0; i < remaining.size(); i++) {
+				bool isBlocked = false;
+				for (size_t j = i + 1; j < remaining.size() && !isBlocked; j++) {
+					isBlocked = Model_MountTable::isNested(remaining[i]->mountpoint, remaining[j]->mountpoint);
+				}
+				if (isBlocked) {
+					blockedMountpoints.push_back(remaining[i]);
+				} else {
+					independentMountpoints.push_back(remaining[i]);
+				}
 			}
+			Model_MountTable::runConcurrently(independentMountpoints, &Model_MountTable_Mountpoint::umount, false);
+			remaining = blockedMountpoints;
 		}
 	
 		this->getEntryRefByMountpoint(prefix).umount();
@@ -251,14 +400,12 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 		if (fstab){
 			fclose(fstab); //opening of fstab is just a test
 	
-			try {
-				this->add(Model_MountTable_Mountpoint("/proc", mountpoint + "/proc", "bind")).mount();
-				this->add(Model_MountTable_Mountpoint("/sys", mountpoint + "/sys", "bind")).mount();
-				this->add(Model_MountTable_Mountpoint("/dev", mountpoint + "/dev", "bind")).mount();
-			}
+			std::list<Model_MountTable_Mountpoint*> bindMounts;
+			bindMounts.push_back(&this->add(Model_MountTable_Mountpoint("/proc", mountpoint + "/proc", "bind")));
+			bindMounts.push_back(&this->add(Model_MountTable_Mountpoint("/sys", mountpoint + "/sys", "bind")));
+			bindMounts.push_back(&this->add(Model_MountTable_Mountpoint("/dev", mountpoint + "/dev", "bind")));
 			//errors while mounting any of this partitions may not be a problem
-			catch (SystemException const& e){}
-			catch (MountpointNotFoundException const& e){}
+			Model_MountTable::runConcurrently(bindMounts, &Model_MountTable_Mountpoint::mount, true);
 		}
 		else
 			throw MissingFstabException("fstab is required but was not found", __FILE__, __LINE__);
@@ -266,27 +413,33 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 	}
 
 	public: Model_MountTable_Mountpoint& findByDevice(std::string device) {
-		for (std::list<Model_MountTable_Mountpoint>::iterator iter = this->begin(); iter != this->end(); iter++){
-			if (iter->device == device) {
-				return *iter;
-			}
+		auto indexEntry = this->deviceIndex.find(device);
+		if (indexEntry != this->deviceIndex.end()) {
+			return *indexEntry->second.front();
 		}
 		throw ItemNotFoundException("no mountpoint found by device " + device);
 	}
 
 	public: Model_MountTable_Mountpoint& getByFilePath(std::string path) {
-		Model_MountTable_Mountpoint* result = NULL;
-		for (std::list<Model_MountTable_Mountpoint>::iterator iter = this->begin(); iter != this->end(); iter++) {
-			// look for the longest matching mountpoint because "/" matches as well as "/mnt" if filename is "/mnt/foo.iso"
-			if (path.substr(0, iter->mountpoint.size()) == iter->mountpoint && (result == NULL || iter->mountpoint.size() > result->mountpoint.size())) {
-				result = &*iter;
+		// look for the longest matching mountpoint because "/" matches as well as "/mnt" if filename is "/mnt/foo.iso".
+		// The longest mountpoint being a prefix of path is the greatest one <= path having this property. Any mountpoint
+		// between them shares a longer prefix with path, so path can be shortened to that common prefix for the next try.
+		std::string key = path;
+		while (true) {
+			auto candidate = this->sortedMountpoints.upper_bound(key);
+			if (candidate == this->sortedMountpoints.begin()) {
+				throw ItemNotFoundException("no mountpoint found by path " + path);
 			}
-		}
-
-		if (result == NULL) {
-			throw ItemNotFoundException("no mountpoint found by path " + path);
-		} else {
-			return *result;
+			candidate--;
+			std::string const& mountpoint = candidate->first;
+			if (key.compare(0, mountpoint.size(), mountpoint) == 0) {
+				return *candidate->second;
+			}
+			size_t commonLength = 0;
+			while (commonLength < key.size() && commonLength < mountpoint.size() && key[commonLength] == mountpoint[commonLength]) {
+				commonLength++;
+			}
+			key.resize(commonLength);
 		}
 	}
 
@@ -298,6 +451,67 @@ class Model_MountTable : public std::list<Model_MountTable_Mountpoint>, public T
 		return result;
 	}
 
+	// runs mount or umount of the given entries in parallel. Rethrows the first error unless ignoreErrors is set
+	private: static void runConcurrently(std::list<Model_MountTable_Mountpoint*> const& mountpoints, void (Model_MountTable_Mountpoint::*action)(), bool ignoreErrors) {
+		std::vector<std::exception_ptr> errors(mountpoints.size());
+		std::vector<std::thread> threads;
+		size_t i = 0;
+		for (auto mountpoint : mountpoints) {
+			std::exception_ptr* error = &errors[i++];
+			threads.push_back(std::thread([mountpoint, action, error] {
+				try {
+					(mountpoint->*action)();
+				} catch (...) {
+					*error = std::current_exception();
+				}
+			}));
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		if (!ignoreErrors) {
+			for (auto& error : errors) {
+				if (error) {
+					std::rethrow_exception(error);
+				}
+			}
+		}
+	}
+
+	// true if one of the directories is inside of the other one
+	private: static bool isNested(std::string const& a, std::string const& b) {
+		std::string const& shorter = a.size() < b.size() ? a : b;
+		std::string const& longer = a.size() < b.size() ? b : a;
+		return longer.compare(0, shorter.size(), shorter) == 0 && longer.size() > shorter.size() && longer[shorter.size()] == '/';
+	}
+
+	private: void addToIndex(Model_MountTable::iterator iter) {
+		this->mountpointIndex[iter->mountpoint] = iter;
+		this->sortedMountpoints[iter->mountpoint] = iter;
+		this->deviceIndex[iter->device].push_back(iter);
+	}
+
+	private: void removeFromIndex(Model_MountTable::iterator iter) {
+		this->mountpointIndex.erase(iter->mountpoint);
+		this->sortedMountpoints.erase(iter->mountpoint);
+		auto deviceEntry = this->deviceIndex.find(iter->device);
+		if (deviceEntry != this->deviceIndex.end()) {
+			deviceEntry->second.remove(iter);
+			if (deviceEntry->second.empty()) {
+				this->deviceIndex.erase(deviceEntry);
+			}
+		}
+	}
+
+	private: void rebuildIndex() {
+		this->mountpointIndex.clear();
+		this->sortedMountpoints.clear();
+		this->deviceIndex.clear();
+		for (Model_MountTable::iterator iter = this->begin(); iter != this->end(); iter++) {
+			this->addToIndex(iter);
+		}
+	}
+
 };
 
 class Model_MountTable_Connection
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+#ifndef GRUB_CUSTOMIZER_PARALLELSCRIPTRUNNER_INCLUDED
+#define GRUB_CUSTOMIZER_PARALLELSCRIPTRUNNER_INCLUDED
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../lib/CancellationToken.hpp"
+#include "../lib/ChildProcess.hpp"
+#include "../lib/Exception.hpp"
+#include "../lib/Helper.hpp"
+#include "../lib/Trait/LoggerAware.hpp"
+#include "Env.hpp"
+#include "ScriptOutputCache.hpp"
+
+/**
+ * alternative to running mkconfig_cmd: executes the scripts of the cfg dir concurrently
+ * and returns their output in the format of mkconfig (in the order mkconfig would use).
+ *
+ * The scripts get the environment exported by mkconfig. It's read by running mkconfig
+ * with an additional script printing its environment and stopping mkconfig. The script
+ * does nothing unless mkconfig has been started by the runner, so a leftover script
+ * (removed by Model_ListCfg::cleanupCfgDir) doesn't affect other mkconfig runs.
+ *
+ * If an output cache is set, only the scripts without valid cache entry are executed.
+ *
+ * When the cancellation token is cancelled, the running scripts are killed and the incomplete output is returned.
+ */
+class Model_ParallelScriptRunner : public Trait_LoggerAware
+{
+	private: std::shared_ptr<Model_Env> env;
+	private: std::string errorLogFile;
+	private: std::shared_ptr<Model_ScriptOutputCache> outputCache;
+	private: bool validateOutputCache;
+	private: std::shared_ptr<CancellationToken> cancellationToken;
+
+	public: Model_ParallelScriptRunner(std::shared_ptr<Model_Env> env, std::string const& errorLogFile, std::shared_ptr<CancellationToken> cancellationToken = nullptr)
+		: env(env), errorLogFile(errorLogFile), validateOutputCache(false), cancellationToken(cancellationToken)
+	{}
+
+	/**
+	 * @param validate if true, all scripts are executed and their output is compared to the cached one
+	 */
+	public: void setOutputCache(std::shared_ptr<Model_ScriptOutputCache> outputCache, bool validate = false)
+	{
+		this->outputCache = outputCache;
+		this->validateOutputCache = validate;
+	}
+
+	// name of the temporary script used to read the environment. It's sorted before the scripts.
+	public: static std::string getEnvironmentScriptName()
+	{
+		return "00_GC_environment";
+	}
+
+	private: static std::string getTokenVariableName()
+	{
+		return "GC_ENVIRONMENT_TOKEN";
+	}
+
+	/**
+	 * returns a temporary file containing the output of all scripts,
+	 * each surrounded by "### BEGIN <script> ###" and "### END <script> ###"
+	 */
+	public: FILE* run()
+	{
+		std::vector<std::string> environment = this->readEnvironment();
+		std::vector<std::string> scripts = this->getScriptList();
+		std::vector<std::string> outputs(scripts.size());
+
+		// the cache key of a script consists of the script, its environment and the files it may scan
+		std::vector<std::string> cacheKeys(scripts.size());
+		std::string environmentDigest, systemFingerprint;
+		if (this->outputCache) {
+			std::string environmentString;
+			for (auto const& variable : environment) {
+				environmentString += variable + '\0';
+			}
+			environmentDigest = Helper::md5(environmentString);
+			systemFingerprint = Model_ScriptOutputCache::getSystemFingerprint(this->env->cfg_dir_prefix);
+		}
+
+		std::vector<std::string> staleScripts;
+		std::vector<size_t> staleScriptIndexes;
+		for (size_t i = 0; i < scripts.size(); i++) {
+			if (this->outputCache) {
+				std::string scriptDigest = Model_ScriptOutputCache::getFileDigest(this->env->cfg_dir_prefix + scripts[i], this->env->cfg_dir_prefix);
+				cacheKeys[i] = Helper::md5(scriptDigest + environmentDigest + systemFingerprint);
+				if (!this->validateOutputCache && this->outputCache->load(this->getScriptName(scripts[i]), cacheKeys[i], outputs[i])) {
+					this->log("using the cached output of " + scripts[i], Logger::INFO);
+					continue;
+				}
+			}
+			staleScripts.push_back(scripts[i]);
+			staleScriptIndexes.push_back(i);
+		}
+
+		std::vector<std::string> staleOutputs = this->runScripts(staleScripts, environment);
+		bool cancelled = CancellationToken::isCancelled(this->cancellationToken);
+		for (size_t i = 0; i < staleScripts.size(); i++) {
+			size_t scriptIndex = staleScriptIndexes[i];
+			outputs[scriptIndex] = staleOutputs[i];
+			if (this->outputCache && !cancelled) {
+				std::string scriptName = this->getScriptName(scripts[scriptIndex]);
+				std::string cachedOutput;
+				if (this->validateOutputCache && this->outputCache->load(scriptName, cacheKeys[scriptIndex], cachedOutput)) {
+					if (cachedOutput != outputs[scriptIndex]) {
+						this->log("cache validation: the cached output of " + scripts[scriptIndex] + " is outdated", Logger::ERROR);
+					} else {
+						this->log("cache validation: the cached output of " + scripts[scriptIndex] + " is up to date", Logger::INFO);
+					}
+				}
+				this->outputCache->save(scriptName, cacheKeys[scriptIndex], outputs[scriptIndex]);
+			}
+		}
+
+		FILE* result = tmpfile();
+		if (result == NULL) {
+			throw FileSaveException("cannot create a temporary file for the script output", __FILE__, __LINE__);
+		}
+		for (size_t i = 0; i < scripts.size(); i++) {
+			fputs(("### BEGIN " + scripts[i] + " ###\n").c_str(), result);
+			fwrite(outputs[i].data(), 1, outputs[i].size(), result);
+			fputs(("### END " + scripts[i] + " ###\n").c_str(), result);
+		}
+		rewind(result);
+		return result;
+	}
+
+	private: std::vector<std::string> readEnvironment()
+	{
+		std::string scriptPath = this->env->cfg_dir + "/" + Model_ParallelScriptRunner::getEnvironmentScriptName();
+		Helper::assert_filepath_empty(scriptPath, __FILE__, __LINE__);
+		FILE* script = fopen(scriptPath.c_str(), "w");
+		if (script == NULL) {
+			throw FileSaveException("cannot create " + scriptPath, __FILE__, __LINE__);
+		}
+		// only the mkconfig process started below gets the token
+		std::string token = Helper::md5(std::to_string(getpid()) + " " + std::to_string(time(NULL)) + " " + scriptPath);
+		// mkconfig is stopped before running the other scripts
+		fputs((
+			"#!/bin/sh\n"
+			"# temporary script of grub-customizer - may be deleted\n"
+			"test \"$" + Model_ParallelScriptRunner::getTokenVariableName() + "\" = '" + token + "' || exit 0\n"
+			"echo '### ENVIRONMENT ###'\n"
+			"env -0\n"
+			"printf '%s\\0' '### END ENVIRONMENT ###'\n"
+			"kill -TERM $PPID\n"
+		).c_str(), script);
+		fclose(script);
+		chmod(scriptPath.c_str(), 0755);
+
+		this->log("reading the environment of " + this->env->mkconfig_cmd, Logger::INFO);
+		std::string output;
+		ChildProcess mkconfig;
+		FILE* mkconfigProc = mkconfig.open(
+			Model_ParallelScriptRunner::getTokenVariableName() + "='" + token + "' " + this->env->mkconfig_cmd + " 2> " + this->errorLogFile,
+			this->cancellationToken
+		);
+		if (mkconfigProc) {
+			char buffer[4096];
+			size_t length = 0;
+			while ((length = fread(buffer, 1, sizeof(buffer), mkconfigProc)) > 0) {
+				output.append(buffer, length);
+			}
+			mkconfig.close(); // fails because mkconfig has been stopped
+		}
+		unlink(scriptPath.c_str());
+
+		std::vector<std::string> result;
+		if (CancellationToken::isCancelled(this->cancellationToken)) {
+			return result;
+		}
+		std::string const beginMarker = "### ENVIRONMENT ###\n";
+		size_t position = output.find(beginMarker);
+		if (position == std::string::npos) {
+			throw CmdExecException("failed reading the environment of " + this->env->mkconfig_cmd, __FILE__, __LINE__);
+		}
+		position += beginMarker.size();
+		size_t end = 0;
+		while ((end = output.find('\0', position)) != std::string::npos) {
+			std::string variable = output.substr(position, end - position);
+			if (variable == "### END ENVIRONMENT ###") {
+				return result;
+			}
+			if (variable.compare(0, Model_ParallelScriptRunner::getTokenVariableName().size() + 1, Model_ParallelScriptRunner::getTokenVariableName() + "=") != 0) {
+				result.push_back(variable);
+			}
+			position = end + 1;
+		}
+		throw CmdExecException("incomplete environment of " + this->env->mkconfig_cmd, __FILE__, __LINE__);
+	}
+
+	// the executable scripts mkconfig would run - as paths within the root used by mkconfig
+	private: std::vector<std::string> getScriptList() const
+	{
+		std::vector<std::string> names;
+		DIR* cfgDir = opendir(this->env->cfg_dir.c_str());
+		if (cfgDir == NULL) {
+			throw DirectoryNotFoundException("grub cfg dir not found", __FILE__, __LINE__);
+		}
+		struct dirent* entry = NULL;
+		while ((entry = readdir(cfgDir))) {
+			std::string name = entry->d_name;
+			std::string path = this->env->cfg_dir + "/" + name;
+			struct stat fileProperties;
+			if (stat(path.c_str(), &fileProperties) != 0 || !S_ISREG(fileProperties.st_mode) || access(path.c_str(), X_OK) != 0) {
+				continue;
+			}
+			// skipped by mkconfig: editor backups, signatures and package manager files
+			if (name[0] == '.' || name[name.size() - 1] == '~' || (name[0] == '#' && name[name.size() - 1] == '#')
+				|| name.find(".dpkg-") != std::string::npos || name.substr(0, 6) == "README" || Model_ParallelScriptRunner::endsWith(name, ".sig")
+				|| Model_ParallelScriptRunner::endsWith(name, ".rpmsave") || Model_ParallelScriptRunner::endsWith(name, ".rpmnew")) {
+				continue;
+			}
+			names.push_back(name);
+		}
+		closedir(cfgDir);
+
+		// shell globbing uses the collation of the current locale
+		std::sort(names.begin(), names.end(), [] (std::string const& a, std::string const& b) {
+			return strcoll(a.c_str(), b.c_str()) < 0;
+		});
+
+		std::vector<std::string> result;
+		for (auto const& name : names) {
+			result.push_back(this->env->cfg_dir_noprefix + "/" + name);
+		}
+		return result;
+	}
+
+	private: std::vector<std::string> runScripts(std::vector<std::string> const& scripts, std::vector<std::string> const& environment)
+	{
+		std::vector<char*> envp;
+		for (auto const& variable : environment) {
+			envp.push_back(const_cast<char*>(variable.c_str()));
+		}
+		envp.push_back(NULL);
+
+		int errorLog = open(this->errorLogFile.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+		std::vector<std::string> outputs(scripts.size());
+		if (CancellationToken::isCancelled(this->cancellationToken)) {
+			return outputs;
+		}
+		std::vector<pid_t> processes(scripts.size(), -1);
+		std::vector<struct pollfd> pipes;
+		std::vector<size_t> pipeScripts; // script index of each pipe
+		for (size_t i = 0; i < scripts.size(); i++) {
+			std::string command = this->env->cmd_prefix + "'" + scripts[i] + "'";
+			int fds[2];
+			if (pipe2(fds, O_CLOEXEC) != 0) {
+				continue;
+			}
+			this->log("running " + scripts[i], Logger::INFO);
+			processes[i] = fork();
+			if (processes[i] == 0) {
+				setpgid(0, 0); // allows killing the script including its children
+				dup2(fds[1], STDOUT_FILENO);
+				if (errorLog != -1) {
+					dup2(errorLog, STDERR_FILENO);
+				}
+				execle("/bin/sh", "sh", "-c", command.c_str(), (char*) NULL, envp.data());
+				_exit(127);
+			}
+			close(fds[1]);
+			if (processes[i] == -1) {
+				close(fds[0]);
+				continue;
+			}
+			setpgid(processes[i], processes[i]);
+			struct pollfd scriptPipe;
+			scriptPipe.fd = fds[0];
+			scriptPipe.events = POLLIN;
+			pipes.push_back(scriptPipe);
+			pipeScripts.push_back(i);
+		}
+		if (errorLog != -1) {
+			close(errorLog);
+		}
+		int cancellationHandlerId = -1;
+		if (this->cancellationToken) {
+			cancellationHandlerId = this->cancellationToken->addHandler([&processes] () {
+				for (pid_t process : processes) {
+					if (process > 0) {
+						kill(-process, SIGTERM);
+					}
+				}
+			});
+		}
+
+		// collect the output of all scripts while they are running
+		size_t openPipeCount = pipes.size();
+		char buffer[65536];
+		while (openPipeCount > 0) {
+			if (poll(pipes.data(), pipes.size(), -1) == -1) {
+				if (errno == EINTR) {
+					continue;
+				}
+				break;
+			}
+			for (size_t i = 0; i < pipes.size(); i++) {
+				if (pipes[i].fd == -1 || pipes[i].revents == 0) {
+					continue;
+				}
+				ssize_t length = read(pipes[i].fd, buffer, sizeof(buffer));
+				if (length > 0) {
+					outputs[pipeScripts[i]].append(buffer, length);
+				} else if (length == 0 || errno != EINTR) {
+					close(pipes[i].fd);
+					pipes[i].fd = -1; // ignored by poll
+					openPipeCount--;
+				}
+			}
+		}
+		for (auto& scriptPipe : pipes) {
+			if (scriptPipe.fd != -1) {
+				close(scriptPipe.fd);
+			}
+		}
+		if (this->cancellationToken) {
+			this->cancellationToken->removeHandler(cancellationHandlerId);
+		}
+
+		std::string failedScripts;
+		for (size_t i = 0; i < scripts.size(); i++) {
+			int status = -1;
+			if (processes[i] == -1 || waitpid(processes[i], &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				failedScripts += (failedScripts != "" ? ", " : "") + scripts[i];
+			}
+		}
+		if (failedScripts != "" && !CancellationToken::isCancelled(this->cancellationToken)) {
+			throw CmdExecException("failed running " + failedScripts, __FILE__, __LINE__);
+		}
+		return outputs;
+	}
+
+	private: std::string getScriptName(std::string const& script) const
+	{
+		return script.substr(this->env->cfg_dir_noprefix.size() + 1);
+	}
+
+	private: static bool endsWith(std::string const& string, std::string const& suffix)
+	{
+		return string.size() >= suffix.size() && string.compare(string.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+};
+
+#endif
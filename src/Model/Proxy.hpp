@@ -35,6 +35,7 @@
 #include "../lib/Type.hpp"
 #include "EntryPathBuilderImpl.hpp"
 #include "ProxyScriptData.hpp"
+#include "ProxyStreamFilter.hpp"
 #include "Rule.hpp"
 #include "Script.hpp"
 
@@ -103,25 +104,25 @@ class Model_Proxy : public Proxy
 				if (iter[1] != '/') {
 					if (!inString){
 						if (inAlias) {
-							rules.back()->outputName = name;
+							rules.back()->outputName = std::move(name);
 						} else if (inFromClause) {
 							rules.back()->__sourceScriptPath = cfgDirPrefix + name;
 						} else {
-							path.push_back(name);
-							rules.push_back(std::make_shared<Model_Rule>(Model_Rule::NORMAL, path, visible));
+							path.push_back(std::move(name));
+							rules.push_back(std::make_shared<Model_Rule>(Model_Rule::NORMAL, std::move(path), visible));
 							path.clear();
 						}
 						inAlias = false;
 						inFromClause = false;
 					}
-					name = "";
+					name.clear();
 				}
 			} else if (!inString && *iter == '*') {
-				rules.push_back(std::make_shared<Model_Rule>(Model_Rule::OTHER_ENTRIES_PLACEHOLDER, path, "*", visible));
+				rules.push_back(std::make_shared<Model_Rule>(Model_Rule::OTHER_ENTRIES_PLACEHOLDER, std::move(path), "*", visible));
 				path.clear();
 			} else if (!inString && *iter == '#' && *++iter == 't' && *++iter == 'e' && *++iter == 'x' && *++iter == 't') {
 				path.push_back("#text");
-				rules.push_back(std::make_shared<Model_Rule>(Model_Rule::PLAINTEXT, path, "#text", visible));
+				rules.push_back(std::make_shared<Model_Rule>(Model_Rule::PLAINTEXT, std::move(path), "#text", visible));
 				path.clear();
 				name = "";
 			} else if (inString) {
@@ -135,8 +136,8 @@ class Model_Proxy : public Proxy
 			} else if (!inString && !inAlias && !inFromClause && *iter == 'f' && *++iter == 'r' && *++iter == 'o' && *++iter == 'm') {
 				inFromClause = true;
 			} else if (!inString && !inAlias && !inFromClause && *iter == '/') {
-				path.push_back(name);
-				name = "";
+				path.push_back(std::move(name));
+				name.clear();
 			} else if (!inString && !inAlias && !inFromClause && *iter == '{') {
 				iter++;
 				rules.back()->subRules = Model_Proxy::parseRuleString(&iter, cfgDirPrefix);
@@ -144,8 +145,8 @@ class Model_Proxy : public Proxy
 			} else if (!inString && *iter == '~') {
 				inHash = !inHash;
 				if (!inHash) {
-					rules.back()->__idHash = hash;
-					hash = "";
+					rules.back()->__idHash = std::move(hash);
+					hash.clear();
 				}
 			}
 		}
@@ -506,17 +507,23 @@ class Model_Proxy : public Proxy
 					fputs("'", proxyFile);
 				}
 				fputs((" | "+cfg_dir_noprefix+"/bin/grubcfg_proxy \"").c_str(), proxyFile);
+				Model_EntryPathBuilderImpl entryPathBuilder(this->dataSource);
+				entryPathBuilder.setScriptTargetMap(scriptTargetMap);
+				entryPathBuilder.setEntrySourceMap(entrySourceMap);
+				entryPathBuilder.setPrefixLength(cfg_dir_prefix_length);
+				std::string ruleString;
 				for (auto rule : this->rules) {
-					assert(this->dataSource != nullptr);
-					Model_EntryPathBuilderImpl entryPathBuilder(this->dataSource);
-					entryPathBuilder.setScriptTargetMap(scriptTargetMap);
-					entryPathBuilder.setEntrySourceMap(entrySourceMap);
-					entryPathBuilder.setPrefixLength(cfg_dir_prefix_length);
-					fputs((rule->toString(entryPathBuilder)+"\n").c_str(), proxyFile); //write rule
+					ruleString += rule->toString(entryPathBuilder) + "\n";
 				}
+				fputs(ruleString.c_str(), proxyFile); //write rules
 				fputs("\"", proxyFile);
 				if (scripts.size() > 1) {
 					fputs(" multi", proxyFile);
+				} else {
+					const char* ruleStringIter = ruleString.c_str();
+					if (Model_ProxyStreamFilter::isApplicable(Model_Proxy::parseRuleString(&ruleStringIter, ""))) {
+						fputs(" stream", proxyFile);
+					}
 				}
 				fclose(proxyFile);
 				chmod(path.c_str(), this->permissions);
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+#ifndef GRUB_CUSTOMIZER_PROXYSTREAMFILTER_INCLUDED
+#define GRUB_CUSTOMIZER_PROXYSTREAMFILTER_INCLUDED
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <memory>
+#include <ostream>
+#include "../lib/LineReader.hpp"
+#include "Entry.hpp"
+#include "Rule.hpp"
+
+/**
+ * streaming variant of the proxy for single script proxies: instead of loading the whole script
+ * output, each menuentry/submenu block is dropped as soon as it has been read unless a rule refers
+ * to it - by path or as first entry having the content hash of a rule. So at most two entries per
+ * rule are held in memory.
+ *
+ * At the end of the input the rules are connected like Model_Proxy::sync does it (entries having
+ * a non-unique path are only found by hash) and printed in rule order. It's only used if new entries
+ * are hidden (see isApplicable), so the rules generated for them don't have to be built.
+ */
+class Model_ProxyStreamFilter
+{
+	private: std::list<std::shared_ptr<Model_Rule>> rules;
+	private: std::set<std::string> rulePaths; // path parts separated by '\0'
+	private: std::set<std::string> ruleHashes;
+	private: std::map<std::string, int> topLevelNameCounts; // only the first path parts of the rules
+	private: std::map<std::string, std::shared_ptr<Model_Entry>> entriesByPath; // unique within their top level entry
+	private: std::map<std::string, std::shared_ptr<Model_Entry>> entriesByHash;
+	private: bool plaintextRequired;
+
+	// the given rules are connected to the entries read by run()
+	public: Model_ProxyStreamFilter(std::list<std::shared_ptr<Model_Rule>> const& rules)
+		: rules(rules), plaintextRequired(false)
+	{
+		if (!Model_ProxyStreamFilter::isApplicable(rules)) {
+			throw LogicException("the given rules cannot be used for stream filtering", __FILE__, __LINE__);
+		}
+		this->collectRuleKeys(rules);
+	}
+
+	/**
+	 * checks whether the rules only contain constructs supported by the filter: rules of the own
+	 * script only and hidden placeholders including one for the top level (otherwise the proxy
+	 * would add a visible one)
+	 */
+	public: static bool isApplicable(std::list<std::shared_ptr<Model_Rule>> const& rules)
+	{
+		bool hasTopLevelPlaceholder = false;
+		return Model_ProxyStreamFilter::isApplicable(rules, hasTopLevelPlaceholder) && hasTopLevelPlaceholder;
+	}
+
+	private: static bool isApplicable(std::list<std::shared_ptr<Model_Rule>> const& rules, bool& hasTopLevelPlaceholder)
+	{
+		for (auto rule : rules) {
+			if (rule->__sourceScriptPath != "") {
+				return false; // foreign entry
+			}
+			switch (rule->type) {
+			case Model_Rule::NORMAL:
+			case Model_Rule::PLAINTEXT:
+				if (rule->subRules.size() || rule->__idpath.size() == 0) {
+					return false;
+				}
+				break;
+			case Model_Rule::OTHER_ENTRIES_PLACEHOLDER:
+				// new entries are inserted behind the placeholder
+				if (rule->isVisible || rule->subRules.size()) {
+					return false;
+				}
+				if (rule->__idpath.size() == 0) {
+					hasTopLevelPlaceholder = true;
+				}
+				break;
+			case Model_Rule::SUBMENU:
+				if (!Model_ProxyStreamFilter::isApplicable(rule->subRules, hasTopLevelPlaceholder)) {
+					return false;
+				}
+				break;
+			}
+		}
+		return true;
+	}
+
+	public: void run(LineReader& input, std::ostream& output)
+	{
+		std::string plaintext = "\r\n"; // like the "#text" entry: each entry starts with an empty row
+		Model_Entry_Row row;
+		while ((row = Model_Entry_Row(input))) {
+			Model_Entry_Row rowText = row.ltrim();
+			if (rowText.startsWith("menuentry ") || rowText.startsWith("submenu ")) {
+				auto entry = std::make_shared<Model_Entry>(input, row);
+				if (!*entry) {
+					break; // the single script mode stops reading here
+				}
+				this->addEntry(entry);
+				if (this->plaintextRequired) {
+					plaintext += "\r\n";
+				}
+			} else if (this->plaintextRequired) {
+				plaintext.append(row.data, row.length);
+				plaintext += "\r\n";
+			}
+		}
+		// added in any case - it makes menuentries named "#text" unaddressable
+		this->addEntry(std::make_shared<Model_Entry>("#text", "", this->plaintextRequired ? plaintext : "", Model_Entry::PLAINTEXT));
+
+		this->connect(this->rules);
+		for (auto rule : this->rules) {
+			rule->print(output);
+		}
+		output.flush();
+	}
+
+	private: void collectRuleKeys(std::list<std::shared_ptr<Model_Rule>> const& rules)
+	{
+		for (auto rule : rules) {
+			if (rule->type == Model_Rule::NORMAL || rule->type == Model_Rule::PLAINTEXT) {
+				this->rulePaths.insert(Model_ProxyStreamFilter::getPathKey(rule->__idpath));
+				this->topLevelNameCounts[rule->__idpath.front()] = 0;
+				if (rule->__idHash != "") {
+					this->ruleHashes.insert(rule->__idHash);
+				}
+				if (rule->isVisible && rule->__idpath == std::list<std::string>(1, "#text")) {
+					this->plaintextRequired = true;
+				}
+			} else if (rule->type == Model_Rule::SUBMENU) {
+				this->collectRuleKeys(rule->subRules);
+			}
+		}
+	}
+
+	// keeps the entry and its sub entries if they are referenced by a rule
+	private: void addEntry(std::shared_ptr<Model_Entry> entry)
+	{
+		auto nameCount = this->topLevelNameCounts.find(entry->name);
+		bool isFirstOfName = nameCount != this->topLevelNameCounts.end() && ++nameCount->second == 1;
+		this->indexEntry(entry, entry->name, isFirstOfName);
+	}
+
+	// same lookup rules as the indexes of Model_Script
+	private: void indexEntry(std::shared_ptr<Model_Entry> entry, std::string const& pathKey, bool addressable)
+	{
+		if (addressable && this->rulePaths.find(pathKey) != this->rulePaths.end()) {
+			this->entriesByPath[pathKey] = entry;
+		}
+		if (entry->type == Model_Entry::MENUENTRY && entry->content != "") {
+			// the first entry (in tree order) wins if there are multiple entries having the same content
+			std::string const& hash = entry->getContentHash();
+			if (this->ruleHashes.find(hash) != this->ruleHashes.end() && this->entriesByHash.find(hash) == this->entriesByHash.end()) {
+				this->entriesByHash[hash] = entry;
+			}
+		} else if (entry->type == Model_Entry::SUBMENU) {
+			std::map<std::string, int> nameCounts;
+			for (auto subEntry : entry->subEntries) {
+				nameCounts[subEntry->name]++;
+			}
+			for (auto subEntry : entry->subEntries) {
+				this->indexEntry(subEntry, pathKey + '\0' + subEntry->name, addressable && nameCounts[subEntry->name] == 1);
+			}
+		}
+	}
+
+	// like Model_Proxy::sync_connectExisting and sync_connectExistingByHash
+	private: void connect(std::list<std::shared_ptr<Model_Rule>> const& rules)
+	{
+		for (auto rule : rules) {
+			if (rule->type == Model_Rule::SUBMENU) {
+				this->connect(rule->subRules);
+				continue;
+			}
+			if (rule->type == Model_Rule::OTHER_ENTRIES_PLACEHOLDER) {
+				continue; // hidden - no entries to print
+			}
+			rule->dataSource = nullptr;
+			if (this->topLevelNameCounts[rule->__idpath.front()] == 1) {
+				auto entryIter = this->entriesByPath.find(Model_ProxyStreamFilter::getPathKey(rule->__idpath));
+				if (entryIter != this->entriesByPath.end()) {
+					rule->dataSource = entryIter->second;
+				}
+			}
+			if (!rule->dataSource && rule->__idHash != "") {
+				auto entryIter = this->entriesByHash.find(rule->__idHash);
+				if (entryIter != this->entriesByHash.end()) {
+					rule->dataSource = entryIter->second;
+				}
+			}
+		}
+	}
+
+	private: static std::string getPathKey(std::list<std::string> const& path)
+	{
+		std::string key;
+		for (auto& pathPart : path) {
+			if (key.size()) {
+				key += '\0';
+			}
+			key += pathPart;
+		}
+		return key;
+	}
+};
+
+#endif
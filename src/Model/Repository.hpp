@@ -144,7 +144,7 @@ class Model_Repository : public std::list<std::shared_ptr<Model_Script>>, public
 			if (preserveModifiedScripts && script->isModified()) {
 				continue;
 			}
-			script->entries().clear();
+			script->clearEntries();
 		}
 	}
 
@@ -51,11 +51,11 @@ class Model_Rule : public Rule {
 	public: RuleType type;
 
 	public: Model_Rule(RuleType type, std::list<std::string> path, std::string outputName, bool isVisible)
-		: type(type), isVisible(isVisible), __idpath(path), outputName(outputName), dataSource(nullptr)
+		: type(type), isVisible(isVisible), __idpath(std::move(path)), outputName(std::move(outputName)), dataSource(nullptr)
 	{}
 
 	public: Model_Rule(RuleType type, std::list<std::string> path, bool isVisible)
-		: type(type), isVisible(isVisible), __idpath(path), outputName(path.back()), dataSource(nullptr)
+		: type(type), isVisible(isVisible), outputName(path.back()), __idpath(std::move(path)), dataSource(nullptr)
 	{}
 
 	//generate rule for given entry
@@ -121,7 +121,7 @@ class Model_Rule : public Rule {
 		} else if (dataSource) {
 			result += pathBuilder.buildPathString(this->dataSource, this->type == OTHER_ENTRIES_PLACEHOLDER);
 			if (this->dataSource->content.size() && this->type != Model_Rule::OTHER_ENTRIES_PLACEHOLDER) {
-				result += "~" + Helper::md5(this->dataSource->content) + "~";
+				result += "~" + this->dataSource->getContentHash() + "~";
 			}
 		} else if (type == Model_Rule::SUBMENU) {
 			result += "'SUBMENU'"; // dummy data source
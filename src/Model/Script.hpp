@@ -28,6 +28,7 @@
 #define GRUB_CUSTOMIZER_SCRIPT_INCLUDED
 #include <string>
 #include <list>
+#include <unordered_map>
 #include <cstdlib>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -45,17 +46,31 @@ class Model_Script : public Model_EntryPathFollower, public Trait_LoggerAware, p
 	public: bool isCustomScript;
 	public: std::shared_ptr<Model_Entry> root;
 
+	// lookup indexes, built on demand. Key of entryPathIndex: the path parts, separated by '\0'.
+	// Entries having non-unique names are stored as nullptr (not addressable by path)
+	private: std::unordered_map<std::string, std::shared_ptr<Model_Entry>> entryPathIndex;
+	private: std::unordered_map<std::string, std::shared_ptr<Model_Entry>> entryHashIndex;
+	private: bool indexIsValid;
+	private: unsigned long indexModificationCount;
+
 	public: Model_Script(std::string const& name, std::string const& fileName) :
 		name(name),
 		fileName(fileName),
 		root(std::make_shared<Model_Entry>("DUMMY", "DUMMY", "DUMMY", Model_Entry::SCRIPT_ROOT)),
-		isCustomScript(false)
+		isCustomScript(false),
+		indexIsValid(false),
+		indexModificationCount(0)
 	{
 		FILE* script = fopen(fileName.c_str(), "r");
 		if (script) {
-			Model_Entry_Row row1(script), row2(script);
-			if (row1.text == CUSTOM_SCRIPT_SHEBANG && row2.text == CUSTOM_SCRIPT_PREFIX) {
-				isCustomScript = true;
+			{
+				LineReader reader(script);
+				Model_Entry_Row row1(reader);
+				std::string row1Text = row1.text(); // row1 is invalidated by reading row2
+				Model_Entry_Row row2(reader);
+				if (row1Text == CUSTOM_SCRIPT_SHEBANG && row2.text() == CUSTOM_SCRIPT_PREFIX) {
+					isCustomScript = true;
+				}
 			}
 			fclose(script);
 		}
@@ -97,18 +112,95 @@ class Model_Script : public Model_EntryPathFollower, public Trait_LoggerAware, p
 		return this->fileName.substr(cfg_dir.length(), std::string("/proxifiedScripts/").length()) == "/proxifiedScripts/";
 	}
 
+	// adds a toplevel entry - use this instead of modifying entries() directly to keep the indexes up to date
+	public: void addEntry(std::shared_ptr<Model_Entry> entry, bool prepend = false)
+	{
+		if (prepend) {
+			this->entries().push_front(entry);
+		} else {
+			this->entries().push_back(entry);
+		}
+
+		if (this->indexIsValid) {
+			if (prepend || this->entryPathIndex.find(entry->name) != this->entryPathIndex.end()) {
+				// order of hashes changed or name isn't unique anymore (entries below the existing one must be dropped)
+				this->invalidateIndex();
+			} else {
+				this->indexEntries(std::list<std::shared_ptr<Model_Entry>>(1, entry), "", true);
+			}
+		}
+	}
+
+	public: void clearEntries()
+	{
+		this->entries().clear();
+		this->invalidateIndex();
+	}
+
+	// must be called after modifying the entry tree directly
+	public: void invalidateIndex()
+	{
+		this->indexIsValid = false;
+		this->entryPathIndex.clear();
+		this->entryHashIndex.clear();
+	}
+
+	private: void validateIndex()
+	{
+		if (this->indexIsValid && this->indexModificationCount == Model_Entry::modificationCounter()) {
+			return;
+		}
+		this->invalidateIndex();
+		this->indexModificationCount = Model_Entry::modificationCounter();
+		this->indexEntries(this->entries(), "", true);
+		this->indexIsValid = true;
+	}
+
+	private: void indexEntries(
+		std::list<std::shared_ptr<Model_Entry>> const& list,
+		std::string const& pathPrefix,
+		bool addressable
+	) {
+		std::unordered_map<std::string, int> nameCount;
+		for (auto& entry : list) {
+			nameCount[entry->name]++;
+		}
+
+		for (auto& entry : list) {
+			std::string key = pathPrefix + entry->name;
+			bool entryIsAddressable = addressable && nameCount[entry->name] == 1;
+			if (addressable) {
+				this->entryPathIndex[key] = entryIsAddressable ? entry : nullptr;
+			}
+
+			if (entry->type == Model_Entry::MENUENTRY && entry->content != "") {
+				// the first entry (in tree order) wins if there are multiple entries having the same content
+				this->entryHashIndex.insert(std::make_pair(entry->getContentHash(), entry));
+			} else if (entry->type == Model_Entry::SUBMENU) {
+				this->indexEntries(entry->subEntries, key + '\0', entryIsAddressable);
+			}
+		}
+	}
+
 	public: std::shared_ptr<Model_Entry> getEntryByPath(std::list<std::string> const& path) {
-		std::shared_ptr<Model_Entry> result = nullptr;
 		if (path.size() == 0) { // top level oep
-			result = this->root;
-		} else {
-			for (auto pathPart : path) {
-				result = this->getEntryByName(pathPart, result != nullptr ? result->subEntries : this->entries());
-				if (result == nullptr)
-					return nullptr;
+			return this->root;
+		}
+
+		this->validateIndex();
+
+		std::string key;
+		for (auto& pathPart : path) {
+			if (key.size()) {
+				key += '\0';
 			}
+			key += pathPart;
 		}
-		return result;
+		auto indexItem = this->entryPathIndex.find(key);
+		if (indexItem == this->entryPathIndex.end()) {
+			return nullptr;
+		}
+		return indexItem->second;
 	}
 
 	public: std::shared_ptr<Model_Entry> getEntryByName(
@@ -130,8 +222,17 @@ class Model_Script : public Model_EntryPathFollower, public Trait_LoggerAware, p
 		std::string const& hash,
 		std::list<std::shared_ptr<Model_Entry>>& parentList
 	) {
+		if (&parentList == &this->entries()) {
+			this->validateIndex();
+			auto indexItem = this->entryHashIndex.find(hash);
+			if (indexItem == this->entryHashIndex.end()) {
+				return nullptr;
+			}
+			return indexItem->second;
+		}
+
 		for (auto entry : parentList) {
-			if (entry->type == Model_Entry::MENUENTRY && entry->content != "" && Helper::md5(entry->content) == hash) {
+			if (entry->type == Model_Entry::MENUENTRY && entry->content != "" && entry->getContentHash() == hash) {
 				return entry;
 			} else if (entry->type == Model_Entry::SUBMENU) {
 				auto result = this->getEntryByHash(hash, entry->subEntries);
@@ -262,6 +363,7 @@ class Model_Script : public Model_EntryPathFollower, public Trait_LoggerAware, p
 			if (*iter == entry) {
 				parent->subEntries.erase(iter);
 				this->root->isModified = true;
+				this->invalidateIndex();
 				return;
 			} else if (iter->get()->subEntries.size()) {
 				try {
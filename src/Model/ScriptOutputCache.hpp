@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+#ifndef GRUB_CUSTOMIZER_SCRIPTOUTPUTCACHE_INCLUDED
+#define GRUB_CUSTOMIZER_SCRIPTOUTPUTCACHE_INCLUDED
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../lib/Helper.hpp"
+#include "../lib/Trait/LoggerAware.hpp"
+
+/**
+ * persistent storage of script outputs. Each output is stored together with a key
+ * describing everything the output depends on - it's only returned for the same key.
+ *
+ * File format: first row = key, the rest is the output of the script
+ */
+class Model_ScriptOutputCache : public Trait_LoggerAware
+{
+	private: std::string cacheDir;
+
+	public: Model_ScriptOutputCache(std::string const& cacheDir)
+		: cacheDir(cacheDir)
+	{}
+
+	public: bool load(std::string const& scriptName, std::string const& key, std::string& output) const
+	{
+		std::string content;
+		if (!Model_ScriptOutputCache::readFile(this->getFilePath(scriptName), content)) {
+			return false;
+		}
+		size_t keyEnd = content.find('\n');
+		if (keyEnd == std::string::npos || content.compare(0, keyEnd, key) != 0) {
+			return false;
+		}
+		output = content.substr(keyEnd + 1);
+		return true;
+	}
+
+	public: void save(std::string const& scriptName, std::string const& key, std::string const& output) const
+	{
+		mkdir(this->cacheDir.c_str(), 0755);
+		std::string filePath = this->getFilePath(scriptName);
+		FILE* cacheFile = fopen((filePath + ".new").c_str(), "w");
+		if (cacheFile == NULL) {
+			this->log("cannot write the output cache of " + scriptName, Logger::ERROR);
+			return;
+		}
+		fputs((key + "\n").c_str(), cacheFile);
+		fwrite(output.data(), 1, output.size(), cacheFile);
+		fclose(cacheFile);
+		rename((filePath + ".new").c_str(), filePath.c_str()); // replace the old version at once
+	}
+
+	/**
+	 * digest of the given file. For script forwarders (second row = quoted path of the real script)
+	 * the real script is included.
+	 */
+	public: static std::string getFileDigest(std::string const& filePath, std::string const& cfgDirPrefix)
+	{
+		std::string content;
+		Model_ScriptOutputCache::readFile(filePath, content);
+		size_t secondRowBegin = content.find('\n');
+		if (secondRowBegin != std::string::npos && content.size() > secondRowBegin + 2 && content[secondRowBegin + 1] == '\'') {
+			size_t secondRowEnd = std::min(content.find('\n', secondRowBegin + 1), content.size());
+			if (content[secondRowEnd - 1] == '\'') {
+				std::string forwardedContent;
+				Model_ScriptOutputCache::readFile(cfgDirPrefix + content.substr(secondRowBegin + 2, secondRowEnd - secondRowBegin - 3), forwardedContent);
+				content += forwardedContent;
+			}
+		}
+		return Helper::md5(content);
+	}
+
+	/**
+	 * describes the files scripts search for operating systems: the kernels and other files of /boot
+	 * (by name, size and modification time) and the filesystems of /dev/disk/by-uuid
+	 */
+	public: static std::string getSystemFingerprint(std::string const& cfgDirPrefix)
+	{
+		std::string fingerprint;
+		std::vector<std::string> bootFiles = Model_ScriptOutputCache::listDirectory(cfgDirPrefix + "/boot");
+		for (auto const& fileName : bootFiles) {
+			struct stat fileProperties;
+			if (stat((cfgDirPrefix + "/boot/" + fileName).c_str(), &fileProperties) == 0 && !S_ISDIR(fileProperties.st_mode)) {
+				fingerprint += fileName + ":" + std::to_string(fileProperties.st_size) + ":" + std::to_string(fileProperties.st_mtime) + "\n";
+			}
+		}
+		for (auto const& uuid : Model_ScriptOutputCache::listDirectory("/dev/disk/by-uuid")) {
+			fingerprint += uuid + "\n";
+		}
+		return Helper::md5(fingerprint);
+	}
+
+	private: std::string getFilePath(std::string const& scriptName) const
+	{
+		return this->cacheDir + "/" + scriptName;
+	}
+
+	private: static bool readFile(std::string const& filePath, std::string& content)
+	{
+		FILE* file = fopen(filePath.c_str(), "r");
+		if (file == NULL) {
+			return false;
+		}
+		char buffer[4096];
+		size_t length = 0;
+		while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+			content.append(buffer, length);
+		}
+		fclose(file);
+		return true;
+	}
+
+	private: static std::vector<std::string> listDirectory(std::string const& path)
+	{
+		std::vector<std::string> result;
+		DIR* dir = opendir(path.c_str());
+		if (dir) {
+			struct dirent* entry = NULL;
+			while ((entry = readdir(dir))) {
+				if (entry->d_name[0] != '.') {
+					result.push_back(entry->d_name);
+				}
+			}
+			closedir(dir);
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+};
+
+#endif
@@ -31,8 +31,11 @@
 #include <sstream>
 #include "../lib/Helper.hpp"
 #include <map>
+#include <mutex>
+#include <fontconfig/fontconfig.h>
 #include "Env.hpp"
 #include "SettingsStore.hpp"
+#include "FontCache.hpp"
 
 class Model_SettingsManagerData :
 	public Model_SettingsStore,
@@ -42,8 +45,9 @@ class Model_SettingsManagerData :
 	bool _reloadRequired;
 public:
 	bool color_helper_required;
-	std::string grubFont, oldFontFile;
-	int grubFontSize;
+	std::string grubFont;
+	std::string oldFontFile; // the font file referenced by the settings file
+	int grubFontSize; // -1 if the font hasn't been chosen since it has been loaded/generated
 	Model_SettingsManagerData() : _reloadRequired(false), color_helper_required(false), grubFontSize(-1)
 	{
 	}
@@ -87,7 +91,21 @@ public:
 		return result;
 	}
 
+	// generated fonts are shared by all instances
+	static Model_FontCache& fontCache() {
+		static Model_FontCache cache;
+		return cache;
+	}
+
+	// like "fc-match", the results are kept until the application is closed
 	static std::string getFontFileByName(std::string const& name) {
+		static std::map<std::string, std::string> fontFiles;
+		static std::mutex fontFilesMutex;
+		std::lock_guard<std::mutex> lock(fontFilesMutex);
+		if (fontFiles.find(name) != fontFiles.end()) {
+			return fontFiles[name];
+		}
+
 		std::string result;
 		std::string translatedName = name;
 		int lastWhitespacePos = translatedName.find_last_of(' ');
@@ -100,13 +118,22 @@ public:
 		translatedName = Helper::str_replace(" Oblique", ":Oblique", translatedName);
 		translatedName = Helper::str_replace(" Regular", ":Regular", translatedName);
 	
-		std::string cmd = "fc-match -f '%{file[0]}' '" + translatedName + "'";
-		FILE* proc = popen(cmd.c_str(), "r");
-		int c;
-		while ((c = getc(proc)) != EOF) {
-			result += char(c);
+		FcPattern* pattern = FcNameParse(reinterpret_cast<FcChar8 const*>(translatedName.c_str()));
+		if (pattern) {
+			FcConfigSubstitute(NULL, pattern, FcMatchPattern);
+			FcDefaultSubstitute(pattern);
+			FcResult matchResult;
+			FcPattern* match = FcFontMatch(NULL, pattern, &matchResult);
+			if (match) {
+				FcChar8* file = NULL;
+				if (FcPatternGetString(match, FC_FILE, 0, &file) == FcResultMatch) {
+					result = reinterpret_cast<char const*>(file);
+				}
+				FcPatternDestroy(match);
+			}
+			FcPatternDestroy(pattern);
 		}
-		pclose(proc);
+		fontFiles[name] = result;
 		return result;
 	}
 
@@ -127,6 +154,17 @@ public:
 			}
 		}
 		outputPath = outputPath != "" ? outputPath : this->env->output_config_dir_noprefix + "/unicode.pf2";
+
+		if (this->logger) {
+			Model_SettingsManagerData::fontCache().setLogger(this->logger);
+		}
+		std::string cacheKey = Model_SettingsManagerData::fontCache().getKey(this->env->cfg_dir_prefix + fontFile, fontSize, this->env->mkfont_cmd);
+		if (Model_SettingsManagerData::fontCache().load(cacheKey, this->env->cfg_dir_prefix + outputPath)) {
+			this->setValue("GRUB_FONT", outputPath);
+			return outputPath;
+		}
+		remove((this->env->cfg_dir_prefix + outputPath).c_str()); // the file may be linked to the cache
+
 		std::string cmd = this->env->mkfont_cmd + " --output='" + Helper::str_replace("'", "\\'", outputPath) + "'" + sizeParam + " '" + Helper::str_replace("'", "\\'", fontFile) + "' 2>&1";
 		this->log("running " + cmd, Logger::INFO);
 		FILE* mkfont_proc = popen(cmd.c_str(), "r");
@@ -144,6 +182,7 @@ public:
 			this->log("error running " + this->env->mkfont_cmd, Logger::ERROR);
 			return "";
 		}
+		Model_SettingsManagerData::fontCache().save(cacheKey, this->env->cfg_dir_prefix + outputPath);
 		this->setValue("GRUB_FONT", outputPath);
 		return outputPath;
 	}
@@ -188,14 +227,24 @@ public:
 	
 		FILE* outFile = fopen(this->env->settings_file.c_str(), "w");
 		if (outFile){
-			if (this->oldFontFile != "") {
-				remove(this->oldFontFile.c_str());
-				this->oldFontFile = "";
-			}
-	
 			std::string generatedFont;
-			if (this->grubFont != "") {
-				generatedFont = this->mkFont();
+			if (this->grubFont != "" && this->grubFontSize == -1 && this->oldFontFile != ""
+				&& Model_SettingsManagerData::parsePf2(this->env->cfg_dir_prefix + this->oldFontFile)["NAME"] == this->grubFont) {
+				// font not changed - the existing file is used
+				this->setValue("GRUB_FONT", this->oldFontFile);
+				generatedFont = this->oldFontFile;
+			} else {
+				if (this->oldFontFile != "") {
+					remove(this->oldFontFile.c_str());
+					this->oldFontFile = "";
+				}
+				if (this->grubFont != "") {
+					generatedFont = this->mkFont();
+					if (generatedFont != "") {
+						this->oldFontFile = generatedFont;
+						this->grubFontSize = -1; // like after loading: the size is part of the font name
+					}
+				}
 			}
 			bool background_script_required = false;
 			bool isGraphical = false;
@@ -27,9 +27,19 @@
 #ifndef SMARTFILEHANDLE_H_
 #define SMARTFILEHANDLE_H_
 #include <cstdio>
+#include <cstring>
+#include <cerrno>
 #include <string>
+#include <unistd.h>
 #include "../lib/Exception.hpp"
 
+/**
+ * reads a file, the output of a command or a string
+ *
+ * Files and commands are read in blocks directly from the file descriptor, the data is consumed by
+ * moving a cursor through the buffer. The read* methods return false at the end of the data,
+ * the get* methods throw EndOfFileException instead.
+ */
 class Model_SmartFileHandle {
 public:
 	enum Type {
@@ -38,72 +48,92 @@ public:
 		TYPE_STRING
 	};
 private:
+	static const size_t blockSize = 65536;
 	FILE* proc_or_file;
 	Model_SmartFileHandle::Type type;
-	std::string string; // content for TYPE_STRING
+	std::string buffer; // the whole content for TYPE_STRING
+	size_t bufferPos; // start of the unread data
+	bool sourceEof;
 public:
-	Model_SmartFileHandle() : type(TYPE_STRING), proc_or_file(NULL)
+	Model_SmartFileHandle() : type(TYPE_STRING), proc_or_file(NULL), bufferPos(0), sourceEof(true)
 	{
 	}
 
-	char getChar() {
-		if (type == TYPE_STRING) {
-			if (this->string.size()) {
-				int c = (int) this->string[0];
-				this->string = this->string.substr(1);
-				return c;
-			} else {
-				throw EndOfFileException("end of file", __FILE__, __LINE__);
+	bool readChar(char& c) {
+		if (this->bufferPos == this->buffer.size() && !this->fillBuffer()) {
+			return false;
+		}
+		c = this->buffer[this->bufferPos++];
+		return true;
+	}
+
+	// reads the next row without the trailing newline
+	bool readRow(std::string& row) {
+		size_t searchPos = this->bufferPos;
+		char const* newline;
+		while (!(newline = static_cast<char const*>(memchr(this->buffer.data() + searchPos, '\n', this->buffer.size() - searchPos)))) {
+			searchPos = this->buffer.size() - this->bufferPos; // fillBuffer moves the unread data to the beginning
+			if (!this->fillBuffer()) {
+				if (this->bufferPos == this->buffer.size()) {
+					return false;
+				}
+				row.assign(this->buffer, this->bufferPos, std::string::npos);
+				this->bufferPos = this->buffer.size();
+				return true;
 			}
-		} else {
-			int c = fgetc(this->proc_or_file);
-			if (c != EOF)
-				return c;
-			else
-				throw EndOfFileException("end of file", __FILE__, __LINE__);
 		}
+		size_t newlinePos = newline - this->buffer.data();
+		row.assign(this->buffer, this->bufferPos, newlinePos - this->bufferPos);
+		this->bufferPos = newlinePos + 1;
+		return true;
+	}
+
+	bool readAll(std::string& content) {
+		while (this->fillBuffer()) {}
+		if (this->bufferPos == this->buffer.size()) {
+			return false;
+		}
+		content.assign(this->buffer, this->bufferPos, std::string::npos);
+		this->bufferPos = this->buffer.size();
+		return true;
+	}
+
+	char getChar() {
+		char c;
+		if (!this->readChar(c)) {
+			throw EndOfFileException("end of file", __FILE__, __LINE__);
+		}
+		return c;
 	}
 
 	std::string getRow() {
 		std::string result;
-		int c;
-		try {
-			while ((c = this->getChar()) != EOF && c != '\n'){
-				result += c;
-			}
-		} catch (EndOfFileException const& e) {
-			if (result == "") {
-				throw e;
-			}
+		if (!this->readRow(result)) {
+			throw EndOfFileException("end of file", __FILE__, __LINE__);
 		}
 		return result;
 	}
 
 	std::string getAll() {
 		std::string result;
-		int c;
-		try {
-			while ((c = this->getChar()) != EOF){
-				result += c;
-			}
-		} catch (EndOfFileException const& e) {
-			if (result == "") {
-				throw e;
-			}
+		if (!this->readAll(result)) {
+			throw EndOfFileException("end of file", __FILE__, __LINE__);
 		}
 		return result;
 	}
 
 	void open(std::string const& cmd_or_file, std::string const& mode, Type type) {
-		if (this->proc_or_file || this->string != "")
+		if (this->proc_or_file || this->bufferPos != this->buffer.size())
 			throw HandleNotClosedException("handle not closed - cannot open", __FILE__, __LINE__);
 	
 		this->proc_or_file = NULL;
-		this->string = "";
+		this->buffer = "";
+		this->bufferPos = 0;
+		this->sourceEof = true;
 	
 		switch (type) {
 			case TYPE_STRING:
-				this->string = cmd_or_file;
+				this->buffer = cmd_or_file;
 				break;
 			case TYPE_COMMAND:
 				this->proc_or_file = popen(cmd_or_file.c_str(), mode.c_str());
@@ -115,9 +145,10 @@ public:
 				throw LogicException("unexpected type given");
 		}
 	
-		if (this->proc_or_file || type == TYPE_STRING)
+		if (this->proc_or_file || type == TYPE_STRING) {
 			this->type = type;
-		else
+			this->sourceEof = type == TYPE_STRING;
+		} else
 			throw FileReadException("Cannot read the file/cmd: " + cmd_or_file, __FILE__, __LINE__);
 	}
 
@@ -127,7 +158,6 @@ public:
 	
 		switch (type) {
 			case TYPE_STRING:
-				this->string = "";
 				break;
 			case TYPE_COMMAND:
 				pclose(this->proc_or_file);
@@ -138,8 +168,34 @@ public:
 			default:
 				throw LogicException("unexpected type given");
 		}
+		this->proc_or_file = NULL;
+		this->buffer = "";
+		this->bufferPos = 0;
+		this->sourceEof = true;
 	}
 
+private:
+	// drops the consumed data and appends the next block. Returns false if there's no more data
+	bool fillBuffer() {
+		if (this->sourceEof) {
+			return false;
+		}
+		this->buffer.erase(0, this->bufferPos);
+		this->bufferPos = 0;
+		size_t oldSize = this->buffer.size();
+		this->buffer.resize(oldSize + Model_SmartFileHandle::blockSize);
+		ssize_t readSize;
+		do {
+			readSize = read(fileno(this->proc_or_file), &this->buffer[oldSize], Model_SmartFileHandle::blockSize);
+		} while (readSize == -1 && errno == EINTR);
+		if (readSize > 0) {
+			this->buffer.resize(oldSize + readSize);
+			return true;
+		}
+		this->buffer.resize(oldSize);
+		this->sourceEof = true;
+		return false;
+	}
 };
 
 #endif
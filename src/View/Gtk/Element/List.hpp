@@ -32,6 +32,9 @@
 #include "../../Model/ListItem.hpp"
 #include "../../../lib/Helper.hpp"
 #include <libintl.h>
+#include <list>
+#include <map>
+#include <set>
 
 template<typename TItem, typename TWrapper>
 class View_Gtk_Element_List :
@@ -53,6 +56,7 @@ class View_Gtk_Element_List :
 		Gtk::TreeModelColumn<bool> is_toplevel;
 		Gtk::TreeModelColumn<Pango::EllipsizeMode> ellipsize;
 		Gtk::TreeModelColumn<Glib::RefPtr<Gdk::Pixbuf> > icon;
+		Gtk::TreeModelColumn<int> iconType; // the icon is only rendered again if this changes
 
 		TreeModel()
 		{
@@ -69,8 +73,15 @@ class View_Gtk_Element_List :
 			this->add(is_toplevel);
 			this->add(icon);
 			this->add(ellipsize);
+			this->add(iconType);
 		}
 	};
+
+	// row operations done by the last incremental update (see beginUpdate)
+	public: struct UpdateStatistics {
+		int inserted, moved, changed, unchanged, removed;
+	};
+
 	public: TreeModel treeModel;
 	public: Glib::RefPtr<Gtk::TreeStore> refTreeStore;
 	public: Gtk::CellRendererPixbuf pixbufRenderer;
@@ -78,9 +89,22 @@ class View_Gtk_Element_List :
 	public: Gtk::CellRendererText textRenderer;
 	public: Gtk::TreeViewColumn mainColumn;
 	public: Pango::EllipsizeMode ellipsizeMode;
+	public: UpdateStatistics updateStatistics;
+
+	// incremental update: rows are identified by their rule / script pointer
+	private: typedef std::pair<TItem*, TWrapper*> RowKey;
+	private: bool updateRunning;
+	private: std::map<RowKey, Gtk::TreeModel::iterator> rowIndex;
+	private: std::set<RowKey> updatedRows;
+	private: std::map<RowKey, unsigned int> placedChildCount;
+	private: std::list<Gtk::TreeModel::iterator> insertedRows;
+	private: std::list<View_Model_ListItem<TItem, TWrapper>> pendingItems;
+	private: std::set<RowKey> pendingKeys;
 
 	public:	View_Gtk_Element_List() :
-		ellipsizeMode(Pango::ELLIPSIZE_NONE)
+		ellipsizeMode(Pango::ELLIPSIZE_NONE),
+		updateStatistics(),
+		updateRunning(false)
 	{
 		refTreeStore = Gtk::TreeStore::create(treeModel);
 		this->set_model(refTreeStore);
@@ -119,6 +143,12 @@ class View_Gtk_Element_List :
 		if (listItem.is_placeholder && !options.at(VIEW_SHOW_PLACEHOLDERS)) {
 			return;
 		}
+		if (this->updateRunning) {
+			// placed by endUpdate - knowing all new items, rows which are removed anyway don't have to be moved
+			this->pendingItems.push_back(listItem);
+			this->pendingKeys.insert(RowKey(listItem.entryPtr, listItem.scriptPtr));
+			return;
+		}
 		Gtk::TreeIter entryRow;
 		if (listItem.parentEntry) {
 			try {
@@ -132,7 +162,16 @@ class View_Gtk_Element_List :
 			entryRow = this->refTreeStore->append();
 		}
 
-		Glib::RefPtr<Gdk::Pixbuf> icon;
+		this->fillRow(*entryRow, listItem, options, window);
+	}
+
+	private: void fillRow(
+		Gtk::TreeModel::Row row,
+		View_Model_ListItem<TItem, TWrapper> const& listItem,
+		std::map<ViewOption, bool> const& options,
+		Gtk::Window& window
+	)
+	{
 		std::string outputName = Helper::escapeXml(listItem.name);
 		if (!listItem.is_placeholder) {
 			outputName = "<b>" + outputName + "</b>";
@@ -171,32 +210,243 @@ class View_Gtk_Element_List :
 			outputName += "</small>";
 		}
 
+		Gtk::StockID iconStockId;
+		int iconType = 0;
 		if (listItem.scriptPtr != NULL) {
-			icon = window.render_icon_pixbuf(Gtk::Stock::FILE, options.at(VIEW_SHOW_DETAILS) ? Gtk::ICON_SIZE_LARGE_TOOLBAR : Gtk::ICON_SIZE_MENU);
+			iconStockId = Gtk::Stock::FILE;
+			iconType = 1;
 		} else if (listItem.is_submenu) {
-			icon = window.render_icon_pixbuf(Gtk::Stock::DIRECTORY, options.at(VIEW_SHOW_DETAILS) ? Gtk::ICON_SIZE_LARGE_TOOLBAR : Gtk::ICON_SIZE_MENU);
+			iconStockId = Gtk::Stock::DIRECTORY;
+			iconType = 2;
 		} else if (listItem.is_placeholder) {
-			icon = window.render_icon_pixbuf(Gtk::Stock::FIND, options.at(VIEW_SHOW_DETAILS) ? Gtk::ICON_SIZE_LARGE_TOOLBAR : Gtk::ICON_SIZE_MENU);
+			iconStockId = Gtk::Stock::FIND;
+			iconType = 3;
 		} else {
-			icon = window.render_icon_pixbuf(Gtk::Stock::EXECUTE, options.at(VIEW_SHOW_DETAILS) ? Gtk::ICON_SIZE_LARGE_TOOLBAR : Gtk::ICON_SIZE_MENU);
+			iconStockId = Gtk::Stock::EXECUTE;
+			iconType = 4;
+		}
+		if (options.at(VIEW_SHOW_DETAILS)) {
+			iconType += 4;
 		}
 
 		if (listItem.isModified) {
 			outputName = "<i>" + outputName + "</i>";
 		}
 
-		(*entryRow)[this->treeModel.name] = listItem.name;
-		(*entryRow)[this->treeModel.text] = outputName;
-		(*entryRow)[this->treeModel.is_activated] = listItem.isVisible;
-		(*entryRow)[this->treeModel.relatedRule] = listItem.entryPtr;
-		(*entryRow)[this->treeModel.relatedScript] = listItem.scriptPtr;
-		(*entryRow)[this->treeModel.is_renamable] = false;
-		(*entryRow)[this->treeModel.is_renamable_real] = !listItem.is_placeholder && listItem.scriptPtr == NULL;
-		(*entryRow)[this->treeModel.is_editable] = listItem.isEditable;
-		(*entryRow)[this->treeModel.is_sensitive] = listItem.scriptPtr == NULL;
-		(*entryRow)[this->treeModel.is_toplevel] = listItem.parentEntry == NULL;
-		(*entryRow)[this->treeModel.icon] = icon;
-		(*entryRow)[this->treeModel.ellipsize] = ellipsizeMode;
+		// only changed values are written - each assignment emits a row-changed signal
+		bool changed = false;
+		changed |= this->setRowValue(row, this->treeModel.name, Glib::ustring(listItem.name));
+		changed |= this->setRowValue(row, this->treeModel.text, Glib::ustring(outputName));
+		changed |= this->setRowValue(row, this->treeModel.is_activated, listItem.isVisible);
+		changed |= this->setRowValue(row, this->treeModel.relatedRule, listItem.entryPtr);
+		changed |= this->setRowValue(row, this->treeModel.relatedScript, listItem.scriptPtr);
+		changed |= this->setRowValue(row, this->treeModel.is_renamable, false);
+		changed |= this->setRowValue(row, this->treeModel.is_renamable_real, !listItem.is_placeholder && listItem.scriptPtr == NULL);
+		changed |= this->setRowValue(row, this->treeModel.is_editable, listItem.isEditable);
+		changed |= this->setRowValue(row, this->treeModel.is_sensitive, listItem.scriptPtr == NULL);
+		changed |= this->setRowValue(row, this->treeModel.is_toplevel, listItem.parentEntry == NULL);
+		changed |= this->setRowValue(row, this->treeModel.ellipsize, ellipsizeMode);
+		if (this->setRowValue(row, this->treeModel.iconType, iconType)) {
+			row[this->treeModel.icon] = window.render_icon_pixbuf(iconStockId, options.at(VIEW_SHOW_DETAILS) ? Gtk::ICON_SIZE_LARGE_TOOLBAR : Gtk::ICON_SIZE_MENU);
+			changed = true;
+		}
+		if (changed) {
+			this->updateStatistics.changed++;
+		} else {
+			this->updateStatistics.unchanged++;
+		}
+	}
+
+	/**
+	 * starts an incremental update: the items added until endUpdate() is called replace the current content.
+	 * Existing rows of the same rule/script are reused (moved and updated if required) instead of being recreated,
+	 * so selection and expansion state of unchanged rows are kept
+	 */
+	public:	void beginUpdate()
+	{
+		this->rowIndex.clear();
+		this->updatedRows.clear();
+		this->placedChildCount.clear();
+		this->insertedRows.clear();
+		this->pendingItems.clear();
+		this->pendingKeys.clear();
+		this->updateStatistics = UpdateStatistics();
+		this->updateRunning = true;
+	}
+
+	// applies the items added since beginUpdate(), removes all other rows and expands the new ones
+	public:	void endUpdate(std::map<ViewOption, bool> const& options, Gtk::Window& window)
+	{
+		this->updateRunning = false;
+		this->indexRows(this->refTreeStore->children());
+		try {
+			for (auto& item : this->pendingItems) {
+				Gtk::TreeModel::iterator row = this->placeUpdatedRow(item, options);
+				if (row) {
+					this->fillRow(*row, item, options, window);
+				}
+			}
+			this->removeUnusedRows(Gtk::TreeModel::iterator(), RowKey(NULL, NULL));
+		} catch (ItemNotFoundException const& e) {
+			this->cleanupUpdate();
+			throw;
+		}
+		for (auto& row : this->insertedRows) {
+			this->expand_to_path(this->refTreeStore->get_path(row));
+		}
+		this->cleanupUpdate();
+	}
+
+	private: void cleanupUpdate()
+	{
+		this->rowIndex.clear();
+		this->updatedRows.clear();
+		this->placedChildCount.clear();
+		this->insertedRows.clear();
+		this->pendingItems.clear();
+		this->pendingKeys.clear();
+	}
+
+	public:	bool isUpdateRunning() const
+	{
+		return this->updateRunning;
+	}
+
+	// finds the row of the given item or creates it at the next position of its parent
+	private: Gtk::TreeModel::iterator placeUpdatedRow(
+		View_Model_ListItem<TItem, TWrapper> const& listItem,
+		std::map<ViewOption, bool> const& options
+	)
+	{
+		RowKey parentKey(NULL, NULL);
+		if (listItem.parentEntry) {
+			parentKey = RowKey(listItem.parentEntry, NULL);
+			if (this->updatedRows.find(parentKey) == this->updatedRows.end()) {
+				return Gtk::TreeModel::iterator(); // parent has been skipped
+			}
+		} else if (listItem.parentScript && options.at(VIEW_GROUP_BY_SCRIPT)) {
+			parentKey = RowKey(NULL, listItem.parentScript);
+			if (this->updatedRows.find(parentKey) == this->updatedRows.end()) {
+				throw ItemNotFoundException("script not found", __FILE__, __LINE__);
+			}
+		}
+		Gtk::TreeModel::iterator parentRow;
+		Gtk::TreeModel::Path parentPath;
+		if (parentKey != RowKey(NULL, NULL)) {
+			parentRow = this->rowIndex[parentKey];
+			parentPath = this->refTreeStore->get_path(parentRow);
+		}
+		unsigned int position = this->placedChildCount[parentKey]++;
+
+		// drop rows of removed items instead of moving all following rows
+		while (position < this->getChildCount(parentRow)) {
+			Gtk::TreeModel::iterator rowInTheWay = this->getChildRow(parentRow, position);
+			if (this->pendingKeys.find(this->getRowKey(rowInTheWay)) != this->pendingKeys.end()) {
+				break;
+			}
+			this->eraseRow(rowInTheWay);
+		}
+
+		RowKey key(listItem.entryPtr, listItem.scriptPtr);
+		auto existingRow = this->rowIndex.find(key);
+		if (existingRow != this->rowIndex.end() && this->updatedRows.find(key) == this->updatedRows.end()) {
+			Gtk::TreeModel::Path path = this->refTreeStore->get_path(existingRow->second);
+			unsigned int currentPosition = path[path.size() - 1];
+			path.up();
+			if (path == parentPath) {
+				// rows before the current position have already been placed, so currentPosition >= position
+				if (currentPosition != position) {
+					this->refTreeStore->move(existingRow->second, this->getChildRow(parentRow, position));
+					this->updateStatistics.moved++;
+				}
+				this->updatedRows.insert(key);
+				return existingRow->second;
+			}
+			this->eraseRow(existingRow->second); // moved to another parent
+		}
+
+		Gtk::TreeModel::iterator newRow;
+		if (position < this->getChildCount(parentRow)) {
+			newRow = this->refTreeStore->insert(this->getChildRow(parentRow, position));
+		} else if (parentRow) {
+			newRow = this->refTreeStore->append(parentRow->children());
+		} else {
+			newRow = this->refTreeStore->append();
+		}
+		this->rowIndex[key] = newRow;
+		this->updatedRows.insert(key);
+		this->insertedRows.push_back(newRow);
+		this->updateStatistics.inserted++;
+		return newRow;
+	}
+
+	private: size_t getChildCount(Gtk::TreeModel::iterator parentRow)
+	{
+		return parentRow ? parentRow->children().size() : this->refTreeStore->children().size();
+	}
+
+	private: Gtk::TreeModel::iterator getChildRow(Gtk::TreeModel::iterator parentRow, unsigned int position)
+	{
+		return parentRow ? parentRow->children()[position] : this->refTreeStore->children()[position];
+	}
+
+	private: RowKey getRowKey(Gtk::TreeModel::iterator row) const
+	{
+		TItem* rule = (*row)[this->treeModel.relatedRule];
+		TWrapper* script = (*row)[this->treeModel.relatedScript];
+		return RowKey(rule, script);
+	}
+
+	private: void indexRows(Gtk::TreeNodeChildren const& rows)
+	{
+		for (Gtk::TreeModel::iterator iter = rows.begin(); iter != rows.end(); iter++) {
+			this->rowIndex[this->getRowKey(iter)] = iter;
+			this->indexRows(iter->children());
+		}
+	}
+
+	private: void unindexRows(Gtk::TreeModel::iterator row)
+	{
+		auto indexEntry = this->rowIndex.find(this->getRowKey(row));
+		if (indexEntry != this->rowIndex.end() && indexEntry->second == row) {
+			this->rowIndex.erase(indexEntry);
+		}
+		this->updateStatistics.removed++;
+		for (Gtk::TreeModel::iterator iter = row->children().begin(); iter != row->children().end(); iter++) {
+			this->unindexRows(iter);
+		}
+	}
+
+	private: void eraseRow(Gtk::TreeModel::iterator row)
+	{
+		this->unindexRows(row);
+		this->refTreeStore->erase(row);
+	}
+
+	// rows which haven't been placed during the update are behind the placed ones
+	private: void removeUnusedRows(Gtk::TreeModel::iterator parentRow, RowKey const& parentKey)
+	{
+		unsigned int placedCount = this->placedChildCount[parentKey];
+		while (this->getChildCount(parentRow) > placedCount) {
+			this->eraseRow(this->getChildRow(parentRow, placedCount));
+		}
+		for (unsigned int i = 0; i < placedCount; i++) {
+			Gtk::TreeModel::iterator row = this->getChildRow(parentRow, i);
+			this->removeUnusedRows(row, this->getRowKey(row));
+		}
+	}
+
+	private: template<typename TValue> bool setRowValue(
+		Gtk::TreeModel::Row& row,
+		Gtk::TreeModelColumn<TValue> const& column,
+		TValue const& value
+	)
+	{
+		if (TValue(row[column]) == value) {
+			return false;
+		}
+		row[column] = value;
+		return true;
 	}
 
 	public:	Gtk::TreeModel::iterator getIterByRulePtr(TItem* rulePtr, const Gtk::TreeRow* parentRow = NULL) const
@@ -225,6 +475,18 @@ class View_Gtk_Element_List :
 		throw ItemNotFoundException("script not found", __FILE__, __LINE__);
 	}
 
+	public:	void removeScriptChildren(TWrapper* scriptPtr)
+	{
+		try {
+			Gtk::TreeModel::iterator scriptRow = this->getIterByScriptPtr(scriptPtr);
+			while (scriptRow->children().size()) {
+				this->refTreeStore->erase(scriptRow->children().begin());
+			}
+		} catch (ItemNotFoundException const& e) {
+			// script isn't listed - nothing to remove
+		}
+	}
+
 	public:	void setRuleName(TItem* rule, std::string const& newName)
 	{
 		Gtk::TreeModel::iterator iter = this->getIterByRulePtr(rule);
@@ -550,7 +550,9 @@ class View_Gtk_Main : public View_Main {
 	{
 		this->tvConfList.addListItem(listItem, this->options, this->win);
 
-		tvConfList.expand_all();
+		if (!this->tvConfList.isUpdateRunning()) {
+			tvConfList.expand_all();
+		}
 	}
 
 	public: void showProxyNotFoundMessage()
@@ -647,6 +649,28 @@ class View_Gtk_Main : public View_Main {
 		tvConfList.refTreeStore->clear();
 	}
 
+	public: void clearScript(Proxy* proxy)
+	{
+		this->tvConfList.removeScriptChildren(proxy);
+	}
+
+	public: void beginListUpdate()
+	{
+		this->tvConfList.beginUpdate();
+	}
+
+	public: void endListUpdate()
+	{
+		this->tvConfList.endUpdate(this->options, this->win);
+		auto const& stats = this->tvConfList.updateStatistics;
+		this->log(
+			"list updated - rows inserted: " + std::to_string(stats.inserted) + ", moved: " + std::to_string(stats.moved)
+				+ ", changed: " + std::to_string(stats.changed) + ", unchanged: " + std::to_string(stats.unchanged)
+				+ ", removed: " + std::to_string(stats.removed),
+			Logger::INFO
+		);
+	}
+
 	public: bool confirmUnsavedSwitch()
 	{
 		Gtk::MessageDialog dlg(gettext("Do you want to proceed without saving the current configuration?"), false, Gtk::MESSAGE_WARNING, Gtk::BUTTONS_YES_NO);
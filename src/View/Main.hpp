@@ -118,6 +118,12 @@ public:
 	virtual bool askForEnvironmentSettings(std::string const& failedCmd, std::string const& errorMessage) = 0;
 	//remove everything from the list
 	virtual void clear()=0;
+	//remove the entries of the given script, the script item itself is kept
+	virtual void clearScript(Proxy* proxy)=0;
+	//the entries appended until endListUpdate is called replace the current ones - unchanged items are kept
+	virtual void beginListUpdate()=0;
+	//remove the items which haven't been appended since beginListUpdate
+	virtual void endListUpdate()=0;
 
 	//asks the user whether the current config should be dropped while another action is started
 	virtual bool confirmUnsavedSwitch() = 0;
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef CANCELLATIONTOKEN_H_INCLUDED
+#define CANCELLATIONTOKEN_H_INCLUDED
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/**
+ * cooperative cancellation of a task: the owner calls cancel(), the task checks isCancelled() at points where
+ * stopping is safe. Blocking operations (like waiting for a child process) can register a handler interrupting them.
+ */
+class CancellationToken
+{
+	private: std::atomic<bool> cancelled;
+	private: std::mutex handlerMutex;
+	private: std::map<int, std::function<void ()>> handlers;
+	private: int nextHandlerId;
+
+	public: CancellationToken()
+		: cancelled(false), nextHandlerId(0)
+	{}
+
+	public: void cancel()
+	{
+		std::lock_guard<std::mutex> lock(this->handlerMutex);
+		if (this->cancelled.exchange(true)) {
+			return;
+		}
+		for (auto& handler : this->handlers) {
+			handler.second();
+		}
+	}
+
+	public: bool isCancelled() const
+	{
+		return this->cancelled;
+	}
+
+	/**
+	 * the handler is called by cancel() - or immediately if the token already is cancelled.
+	 * Handlers are called while the handler list is locked, so they must not add or remove handlers.
+	 */
+	public: int addHandler(std::function<void ()> handler)
+	{
+		std::lock_guard<std::mutex> lock(this->handlerMutex);
+		if (this->cancelled) {
+			handler();
+		}
+		int handlerId = this->nextHandlerId++;
+		this->handlers[handlerId] = handler;
+		return handlerId;
+	}
+
+	// the handler isn't running anymore when this function returns
+	public: void removeHandler(int handlerId)
+	{
+		std::lock_guard<std::mutex> lock(this->handlerMutex);
+		this->handlers.erase(handlerId);
+	}
+
+	// for optional tokens
+	public: static bool isCancelled(std::shared_ptr<CancellationToken> const& cancellationToken)
+	{
+		return cancellationToken && cancellationToken->isCancelled();
+	}
+};
+
+#endif /* CANCELLATIONTOKEN_H_INCLUDED */
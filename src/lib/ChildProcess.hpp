@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef CHILDPROCESS_H_INCLUDED
+#define CHILDPROCESS_H_INCLUDED
+#include <string>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "CancellationToken.hpp"
+
+/**
+ * replacement of popen(command, "r") for commands which may have to be cancelled: the command is run
+ * in its own process group, so the shell and all of its children are killed when the token is cancelled.
+ * The reader then gets EOF instead of waiting for the command to complete.
+ */
+class ChildProcess
+{
+	private: std::atomic<pid_t> pid;
+	private: FILE* output;
+	private: std::shared_ptr<CancellationToken> cancellationToken;
+	private: int cancellationHandlerId;
+
+	public: ChildProcess()
+		: pid(-1), output(NULL), cancellationHandlerId(-1)
+	{}
+
+	public: ~ChildProcess()
+	{
+		if (this->output) {
+			this->close();
+		}
+	}
+
+	// returns the stdout of the command or NULL if it cannot be started
+	public: FILE* open(std::string const& command, std::shared_ptr<CancellationToken> cancellationToken = nullptr)
+	{
+		int fds[2];
+		if (pipe2(fds, O_CLOEXEC) != 0) {
+			return NULL;
+		}
+		pid_t pid = fork();
+		if (pid == 0) {
+			setpgid(0, 0);
+			dup2(fds[1], STDOUT_FILENO);
+			execl("/bin/sh", "sh", "-c", command.c_str(), (char*) NULL);
+			_exit(127);
+		}
+		::close(fds[1]);
+		if (pid == -1) {
+			::close(fds[0]);
+			return NULL;
+		}
+		setpgid(pid, pid); // also set by the child - whichever comes first, kill() cannot hit the wrong group
+		this->pid = pid;
+		this->output = fdopen(fds[0], "r");
+		if (cancellationToken) {
+			this->cancellationToken = cancellationToken;
+			this->cancellationHandlerId = cancellationToken->addHandler(std::bind(std::mem_fn(&ChildProcess::kill), this, SIGTERM));
+		}
+		return this->output;
+	}
+
+	// sends the signal to the command and all of its children
+	public: void kill(int signal)
+	{
+		pid_t pid = this->pid;
+		if (pid > 0) {
+			::kill(-pid, signal);
+		}
+	}
+
+	// like pclose: returns the exit status of the command or -1 on error
+	public: int close()
+	{
+		if (this->cancellationToken) {
+			this->cancellationToken->removeHandler(this->cancellationHandlerId);
+			this->cancellationToken = nullptr;
+		}
+		if (this->output) {
+			fclose(this->output);
+			this->output = NULL;
+		}
+		int status = -1;
+		pid_t pid = this->pid;
+		if (pid > 0) {
+			while (waitpid(pid, &status, 0) == -1 && errno == EINTR) {}
+		}
+		this->pid = -1;
+		return status;
+	}
+};
+
+#endif /* CHILDPROCESS_H_INCLUDED */
@@ -167,6 +167,12 @@ class MountException : public SystemException {
 	   : SystemException(message, file, line) {}
 };
 
+// the mount can't be done without mount(8) - e.g. it needs a helper or a loop device
+class MountNeedsHelperException : public MountException {
+	public: inline MountNeedsHelperException(std::string const& message, std::string const& file = "", int line = -1)
+	   : MountException(message, file, line) {}
+};
+
 class UMountException : public SystemException {
 	public: inline UMountException(std::string const& message, std::string const& file = "", int line = -1)
 	   : SystemException(message, file, line) {}
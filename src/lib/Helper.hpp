@@ -56,11 +56,7 @@ class Helper {
 
 	public: static std::string md5(std::string const& input) {
 		unsigned char buf[16];
-		unsigned char* cStr = new unsigned char[input.length() + 1];
-		for (int i = 0; i < input.length(); i++) {
-			cStr[i] = static_cast<unsigned char>(input[i]);
-		}
-		MD5(cStr, input.length(), buf);
+		MD5(reinterpret_cast<unsigned char const*>(input.data()), input.length(), buf);
 
 		std::string result;
 		for (int i = 0; i < 16; i++) {
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef LINEREADER_H_
+#define LINEREADER_H_
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * reads a FILE* line by line without per-character calls
+ *
+ * Regular files are mapped into memory (starting at the current file position), everything else
+ * (pipes, stdin) is read in large blocks directly from the file descriptor, so pipes must not have been
+ * read using stdio before. Lines are returned as pointer + length into the internal buffer, so they
+ * are only valid until the next call of readLine.
+ */
+class LineReader {
+	private: FILE* source;
+	private: std::vector<char> buffer;
+	private: size_t blockSize, bufferPos, bufferEnd;
+	private: bool sourceEof;
+
+	private: char* mappedData;
+	private: size_t mappedSize, mappedPos;
+
+	public: LineReader(FILE* source, size_t blockSize = 65536) :
+		source(source),
+		blockSize(blockSize),
+		bufferPos(0),
+		bufferEnd(0),
+		sourceEof(false),
+		mappedData(NULL),
+		mappedSize(0),
+		mappedPos(0)
+	{
+		struct stat fileProperties;
+		if (fstat(fileno(source), &fileProperties) == 0 && S_ISREG(fileProperties.st_mode) && fileProperties.st_size > 0) {
+			long offset = ftell(source); // takes data already buffered by stdio into account
+			if (offset >= 0 && offset < fileProperties.st_size) {
+				void* data = mmap(NULL, fileProperties.st_size, PROT_READ, MAP_PRIVATE, fileno(source), 0);
+				if (data != MAP_FAILED) {
+					this->mappedData = static_cast<char*>(data);
+					this->mappedSize = fileProperties.st_size;
+					this->mappedPos = offset;
+				}
+			}
+		}
+	}
+
+	public: ~LineReader()
+	{
+		if (this->mappedData) {
+			munmap(this->mappedData, this->mappedSize);
+			fseek(this->source, this->mappedPos, SEEK_SET); // continue behind the consumed data
+		}
+	}
+
+	/**
+	 * returns false if there's no more data. The line doesn't contain the trailing newline.
+	 */
+	public: bool readLine(char const*& data, size_t& length)
+	{
+		if (this->mappedData) {
+			if (this->mappedPos >= this->mappedSize) {
+				return false;
+			}
+			char const* begin = this->mappedData + this->mappedPos;
+			char const* newline = static_cast<char const*>(memchr(begin, '\n', this->mappedSize - this->mappedPos));
+			data = begin;
+			if (newline) {
+				length = newline - begin;
+				this->mappedPos += length + 1;
+			} else {
+				length = this->mappedSize - this->mappedPos;
+				this->mappedPos = this->mappedSize;
+			}
+			return true;
+		}
+
+		if (this->buffer.size() == 0) {
+			this->buffer.resize(this->blockSize);
+		}
+
+		size_t searchPos = this->bufferPos;
+		while (true) {
+			char* begin = &this->buffer[0] + this->bufferPos;
+			char* newline = static_cast<char*>(memchr(&this->buffer[0] + searchPos, '\n', this->bufferEnd - searchPos));
+			if (newline) {
+				data = begin;
+				length = newline - begin;
+				this->bufferPos += length + 1;
+				return true;
+			}
+
+			if (this->sourceEof) {
+				if (this->bufferPos == this->bufferEnd) {
+					return false;
+				}
+				data = begin;
+				length = this->bufferEnd - this->bufferPos;
+				this->bufferPos = this->bufferEnd;
+				return true;
+			}
+
+			// move the incomplete line to the beginning, grow the buffer if the line doesn't fit
+			size_t remaining = this->bufferEnd - this->bufferPos;
+			if (remaining && this->bufferPos) {
+				memmove(&this->buffer[0], begin, remaining);
+			}
+			this->bufferPos = 0;
+			this->bufferEnd = remaining;
+			searchPos = remaining;
+			if (this->bufferEnd == this->buffer.size()) {
+				this->buffer.resize(this->buffer.size() * 2);
+			}
+
+			ssize_t readSize = read(fileno(this->source), &this->buffer[0] + this->bufferEnd, this->buffer.size() - this->bufferEnd);
+			if (readSize > 0) {
+				this->bufferEnd += readSize;
+			} else if (readSize == 0 || errno != EINTR) {
+				this->sourceEof = true;
+			}
+		}
+	}
+};
+
+#endif /* LINEREADER_H_ */
@@ -56,6 +56,9 @@ class Logger
 	public: virtual void logActionEnd() = 0;
 	public: virtual void logActionBeginThreaded(std::string const& controller, std::string const& action) = 0;
 	public: virtual void logActionEndThreaded() = 0;
+
+	// writes buffered messages - called on errors and before exiting
+	public: virtual void flush() {}
 };
 
 #endif
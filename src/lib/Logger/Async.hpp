@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef ASYNC_LOGGER_H_
+#define ASYNC_LOGGER_H_
+#include "../Logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * forwards everything to another logger, but does it on a background thread.
+ *
+ * Producers copy their messages into a bounded ring buffer of fixed-size records
+ * (longer messages use several consecutive records) without taking a lock. The
+ * background thread sleeps while the buffer is empty. After being woken up it
+ * collects records for up to BATCH_DELAY before passing them to the wrapped
+ * logger and flushing it once. If the buffer is full, messages are dropped and
+ * their number is reported. Errors are flushed synchronously.
+ */
+class Logger_Async : public Logger {
+	public: static const size_t RECORD_TEXT_SIZE = 232;
+	public: static const int BATCH_DELAY_MS = 10;
+
+	private: enum RecordType {
+		LOG,
+		ACTION_BEGIN,
+		ACTION_END,
+		ACTION_BEGIN_THREADED,
+		ACTION_END_THREADED
+	};
+
+	private: enum ConsumerState {
+		CONSUMER_RUNNING,
+		CONSUMER_SLEEPING, // buffer empty - the next producer must wake it up
+		CONSUMER_BATCHING  // waiting for more records - producers wake it up when the buffer is half full
+	};
+
+	private: struct Record {
+		std::atomic<size_t> sequence; // == position + 1 when published, position + capacity when free again
+		RecordType type;
+		Priority prio;
+		unsigned short continuationCount; // number of following records containing the rest of the text
+		unsigned short length;
+		char text[RECORD_TEXT_SIZE];
+	};
+
+	private: std::shared_ptr<Logger> logger;
+	private: std::unique_ptr<Record[]> records;
+	private: size_t capacity;
+	private: std::atomic<size_t> enqueuePosition;
+	private: size_t dequeuePosition; // only accessed by the background thread
+	private: std::atomic<size_t> processedPosition;
+	private: std::atomic<unsigned long> droppedMessages;
+	private: unsigned long reportedDroppedMessages; // only accessed by the background thread
+	private: std::atomic<bool> stopRequested;
+	private: std::atomic<ConsumerState> consumerState;
+	private: int flushRequests; // protected by wakeupMutex
+	private: std::mutex wakeupMutex;
+	private: std::condition_variable wakeupCondition, processedCondition;
+	private: std::thread thread;
+
+	// capacity is the number of records and is rounded up to a power of two
+	public: Logger_Async(std::shared_ptr<Logger> logger, size_t capacity = 4096)
+		: logger(logger), capacity(1), enqueuePosition(0), dequeuePosition(0), processedPosition(0),
+		  droppedMessages(0), reportedDroppedMessages(0), stopRequested(false), consumerState(CONSUMER_RUNNING), flushRequests(0)
+	{
+		while (this->capacity < capacity) {
+			this->capacity <<= 1;
+		}
+		this->records = std::unique_ptr<Record[]>(new Record[this->capacity]);
+		for (size_t i = 0; i < this->capacity; i++) {
+			this->records[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		this->thread = std::thread(&Logger_Async::run, this);
+	}
+
+	public: ~Logger_Async() {
+		{
+			std::lock_guard<std::mutex> lock(this->wakeupMutex);
+			this->stopRequested = true;
+		}
+		this->wakeupCondition.notify_one();
+		this->thread.join();
+	}
+
+	public: void log(std::string const& str, Priority prio) {
+		if (prio == Logger::ERROR || prio == Logger::EXCEPTION) {
+			// errors must not get lost: make room if required and wait until they are written
+			while (!this->enqueue(LOG, prio, str.data(), str.size(), false)) {
+				this->flush();
+			}
+			this->flush();
+		} else {
+			this->enqueue(LOG, prio, str.data(), str.size());
+		}
+	}
+
+	public: void logActionBegin(std::string const& controller, std::string const& action) {
+		std::string text = controller + '\0' + action;
+		this->enqueue(ACTION_BEGIN, Logger::EVENT, text.data(), text.size());
+	}
+
+	public: void logActionEnd() {
+		this->enqueue(ACTION_END, Logger::EVENT, "", 0);
+	}
+
+	public: void logActionBeginThreaded(std::string const& controller, std::string const& action) {
+		std::string text = controller + '\0' + action;
+		this->enqueue(ACTION_BEGIN_THREADED, Logger::EVENT, text.data(), text.size());
+	}
+
+	public: void logActionEndThreaded() {
+		this->enqueue(ACTION_END_THREADED, Logger::EVENT, "", 0);
+	}
+
+	// waits until everything logged before was written
+	public: void flush() {
+		if (std::this_thread::get_id() == this->thread.get_id()) {
+			return; // called by the wrapped logger
+		}
+		size_t position = this->enqueuePosition.load();
+		std::unique_lock<std::mutex> lock(this->wakeupMutex);
+		this->flushRequests++;
+		this->wakeupCondition.notify_one();
+		this->processedCondition.wait(lock, [this, position] {
+			return this->processedPosition.load() >= position || this->stopRequested;
+		});
+		this->flushRequests--;
+	}
+
+	public: unsigned long getDroppedMessages() const {
+		return this->droppedMessages.load();
+	}
+
+	// returns false if the buffer is full
+	private: bool enqueue(RecordType type, Priority prio, char const* text, size_t length, bool countDropped = true) {
+		size_t count = std::min(std::max<size_t>((length + RECORD_TEXT_SIZE - 1) / RECORD_TEXT_SIZE, 1), this->capacity);
+		length = std::min(length, count * RECORD_TEXT_SIZE);
+
+		// reserve count consecutive records. They are released in order, so if the last one is free, all of them are
+		size_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+		while (true) {
+			size_t lastPosition = position + count - 1;
+			size_t sequence = this->records[lastPosition & (this->capacity - 1)].sequence.load(std::memory_order_acquire);
+			if (sequence == lastPosition) {
+				if (this->enqueuePosition.compare_exchange_weak(position, position + count, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (static_cast<long>(sequence - lastPosition) < 0) {
+				if (countDropped) {
+					this->droppedMessages++; // never block the caller
+				}
+				return false;
+			} else {
+				position = this->enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		// publish the first record last - the background thread starts reading once it's visible
+		for (size_t i = count; i-- > 0;) {
+			Record& record = this->records[(position + i) & (this->capacity - 1)];
+			size_t offset = i * RECORD_TEXT_SIZE;
+			record.type = type;
+			record.prio = prio;
+			record.continuationCount = count - 1 - i;
+			record.length = std::min(length - offset, size_t(RECORD_TEXT_SIZE));
+			memcpy(record.text, text + offset, record.length);
+			// sequentially consistent like consumerState: either the consumer sees the record or we see that it's sleeping
+			record.sequence.store(position + i + 1, i == 0 ? std::memory_order_seq_cst : std::memory_order_release);
+		}
+
+		ConsumerState state = this->consumerState.load();
+		bool halfFull = position + count - this->processedPosition.load() >= this->capacity / 2;
+		if ((state == CONSUMER_SLEEPING || (state == CONSUMER_BATCHING && halfFull))
+			&& this->consumerState.compare_exchange_strong(state, CONSUMER_RUNNING)) {
+			std::lock_guard<std::mutex> lock(this->wakeupMutex);
+			this->wakeupCondition.notify_one();
+		}
+		return true;
+	}
+
+	private: void run() {
+		while (true) {
+			bool processed = this->processRecords();
+			if (processed) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(this->wakeupMutex);
+			this->consumerState = CONSUMER_SLEEPING;
+			if (this->stopRequested && !this->hasRecord()) {
+				break;
+			}
+			this->wakeupCondition.wait(lock, [this] {
+				return this->stopRequested || this->hasRecord();
+			});
+
+			if (!this->stopRequested && this->flushRequests == 0) {
+				this->consumerState = CONSUMER_BATCHING;
+				this->wakeupCondition.wait_for(lock, std::chrono::milliseconds(int(BATCH_DELAY_MS)), [this] {
+					return this->stopRequested || this->flushRequests != 0 || this->consumerState == CONSUMER_RUNNING;
+				});
+			}
+			this->consumerState = CONSUMER_RUNNING;
+		}
+		this->processedPosition.store(this->enqueuePosition.load());
+		this->processedCondition.notify_all();
+	}
+
+	private: bool hasRecord() const {
+		return this->records[this->dequeuePosition & (this->capacity - 1)].sequence.load() == this->dequeuePosition + 1;
+	}
+
+	// writes the available records, returns false if there weren't any
+	private: bool processRecords() {
+		bool processed = false;
+		std::string text;
+		while (this->hasRecord()) {
+			Record& first = this->records[this->dequeuePosition & (this->capacity - 1)];
+			RecordType type = first.type;
+			Priority prio = first.prio;
+			size_t count = first.continuationCount + 1;
+			text.clear();
+			for (size_t i = 0; i < count; i++) {
+				Record& record = this->records[(this->dequeuePosition + i) & (this->capacity - 1)];
+				text.append(record.text, record.length);
+			}
+			for (size_t i = 0; i < count; i++) {
+				this->records[(this->dequeuePosition + i) & (this->capacity - 1)].sequence.store(this->dequeuePosition + i + this->capacity, std::memory_order_release);
+			}
+			this->dequeuePosition += count;
+
+			this->write(type, prio, text);
+			processed = true;
+		}
+
+		unsigned long droppedMessages = this->droppedMessages.load();
+		if (droppedMessages != this->reportedDroppedMessages) {
+			this->logger->log(std::to_string(droppedMessages - this->reportedDroppedMessages) + " log messages dropped (buffer full)", Logger::WARNING);
+			this->reportedDroppedMessages = droppedMessages;
+			processed = true;
+		}
+
+		if (processed) {
+			this->logger->flush();
+			std::lock_guard<std::mutex> lock(this->wakeupMutex);
+			this->processedPosition.store(this->dequeuePosition);
+			this->processedCondition.notify_all();
+		}
+		return processed;
+	}
+
+	private: void write(RecordType type, Priority prio, std::string const& text) {
+		size_t separator = text.find('\0');
+		switch (type) {
+		case LOG:
+			this->logger->log(text, prio);
+			break;
+		case ACTION_BEGIN:
+			this->logger->logActionBegin(text.substr(0, separator), text.substr(separator + 1));
+			break;
+		case ACTION_END:
+			this->logger->logActionEnd();
+			break;
+		case ACTION_BEGIN_THREADED:
+			this->logger->logActionBeginThreaded(text.substr(0, separator), text.substr(separator + 1));
+			break;
+		case ACTION_END_THREADED:
+			this->logger->logActionEndThreaded();
+			break;
+		}
+	}
+};
+
+#endif /* ASYNC_LOGGER_H_ */
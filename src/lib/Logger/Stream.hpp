@@ -35,6 +35,7 @@
 class Logger_Stream : public Logger {
 	std::ostream* stream;
 	int actionStackDepth;
+	bool autoFlush; // flush after each message - disable if the caller flushes in batches
 public:
 	enum LogLevel {
 		LOG_NOTHING,
@@ -43,7 +44,7 @@ public:
 		LOG_EVENT,
 		LOG_VERBOSE
 	} logLevel;
-	Logger_Stream(std::ostream& stream) : stream(&stream), actionStackDepth(0), logLevel(LOG_NOTHING) {}
+	Logger_Stream(std::ostream& stream) : stream(&stream), actionStackDepth(0), autoFlush(true), logLevel(LOG_NOTHING) {}
 
 	void log(std::string const& message, Logger::Priority prio) {
 		if (prio != ERROR && (
@@ -69,7 +70,7 @@ public:
 			*this->stream << "]";
 		}
 	
-		*this->stream << std::endl;
+		this->endLine();
 	}
 
 	void logActionBegin(std::string const& controller, std::string const& action) {
@@ -78,7 +79,8 @@ public:
 			for (int i = 0; i < actionStackDepth; i++) {
 				*this->stream << " ";
 			}
-			*this->stream << "-> " << controller << "/" << action << std::endl;
+			*this->stream << "-> " << controller << "/" << action;
+			this->endLine();
 		}
 	}
 
@@ -88,7 +90,7 @@ public:
 				actionStackDepth--;
 			}
 			if (actionStackDepth == 0) {
-				*this->stream << std::endl;
+				this->endLine();
 			}
 		}
 	}
@@ -105,6 +107,22 @@ public:
 		this->logLevel = level;
 	}
 
+	void setAutoFlush(bool autoFlush) {
+		this->autoFlush = autoFlush;
+	}
+
+	void flush() {
+		this->stream->flush();
+	}
+
+private:
+	void endLine() {
+		*this->stream << '\n';
+		if (this->autoFlush) {
+			this->stream->flush();
+		}
+	}
+
 };
 
 #endif
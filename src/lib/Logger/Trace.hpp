@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef TRACE_LOGGER_H_
+#define TRACE_LOGGER_H_
+#include "../Logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * forwards everything to another logger and records the controller actions
+ * with their duration and thread. The recorded events can be exported as
+ * Chrome trace-event JSON (chrome://tracing, Perfetto).
+ */
+class Logger_Trace : public Logger {
+	private: struct Event {
+		char phase; // 'X' = complete event (action), 'i' = instant event (log message)
+		std::string name, category;
+		std::chrono::steady_clock::duration begin, duration;
+		int threadId;
+	};
+
+	private: struct OpenAction {
+		std::string controller, action;
+		std::chrono::steady_clock::time_point begin;
+	};
+
+	private: struct ActionStatistics {
+		unsigned long count;
+		std::chrono::steady_clock::duration totalDuration, maxDuration;
+		std::vector<unsigned long> histogram; // bucket i counts durations < 2^i µs
+
+		ActionStatistics() : count(0), totalDuration(0), maxDuration(0), histogram(Logger_Trace::HISTOGRAM_BUCKETS, 0) {}
+	};
+
+	public: static const size_t HISTOGRAM_BUCKETS = 32;
+
+	private: std::shared_ptr<Logger> logger;
+	private: std::chrono::steady_clock::time_point startTime;
+	private: size_t maxEvents;
+	private: unsigned long droppedEvents;
+	private: std::list<Event> events;
+	private: std::map<std::string, ActionStatistics> statistics;
+	private: std::map<std::thread::id, int> threadIds;
+	private: std::map<int, std::list<OpenAction>> actionStacks;
+	private: std::mutex mutex;
+
+	public: Logger_Trace(std::shared_ptr<Logger> logger, size_t maxEvents = 1000000)
+		: logger(logger), startTime(std::chrono::steady_clock::now()), maxEvents(maxEvents), droppedEvents(0)
+	{}
+
+	public: void log(std::string const& str, Priority prio) {
+		if (prio != Logger::DEBUG) {
+			auto now = std::chrono::steady_clock::now();
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->addEvent('i', str, "log", now - this->startTime, std::chrono::steady_clock::duration(0));
+		}
+		this->logger->log(str, prio);
+	}
+
+	public: void logActionBegin(std::string const& controller, std::string const& action) {
+		this->beginAction(controller, action);
+		this->logger->logActionBegin(controller, action);
+	}
+
+	public: void logActionEnd() {
+		this->endAction();
+		this->logger->logActionEnd();
+	}
+
+	public: void logActionBeginThreaded(std::string const& controller, std::string const& action) {
+		this->beginAction(controller, action);
+		this->logger->logActionBeginThreaded(controller, action);
+	}
+
+	public: void logActionEndThreaded() {
+		this->endAction();
+		this->logger->logActionEndThreaded();
+	}
+
+	public: void flush() {
+		this->logger->flush();
+	}
+
+	public: void writeChromeTrace(std::ostream& out) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+		int pid = getpid();
+
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		for (auto& thread : this->threadIds) {
+			out << (first ? "" : ",\n");
+			out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << thread.second
+				<< ",\"args\":{\"name\":\"" << (thread.second == 1 ? std::string("main") : "thread " + std::to_string(thread.second)) << "\"}}";
+			first = false;
+		}
+		for (auto& event : this->events) {
+			out << (first ? "" : ",\n");
+			out << "{\"ph\":\"" << event.phase << "\",\"name\":\"" << Logger_Trace::escape(event.name)
+				<< "\",\"cat\":\"" << Logger_Trace::escape(event.category)
+				<< "\",\"pid\":" << pid << ",\"tid\":" << event.threadId
+				<< ",\"ts\":" << Logger_Trace::toMicroSec(event.begin);
+			if (event.phase == 'X') {
+				out << ",\"dur\":" << Logger_Trace::toMicroSec(event.duration);
+			} else {
+				out << ",\"s\":\"t\"";
+			}
+			out << "}";
+			first = false;
+		}
+		out << "\n]}\n";
+	}
+
+	// logs count, total/max duration and the latency histogram of each action
+	public: void dumpStatistics() {
+		std::map<std::string, ActionStatistics> statistics;
+		unsigned long droppedEvents;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			statistics = this->statistics;
+			droppedEvents = this->droppedEvents;
+		}
+
+		this->logger->log("action timing (" + std::to_string(statistics.size()) + " actions)", Logger::IMPORTANT_EVENT);
+		for (auto& action : statistics) {
+			std::ostringstream message;
+			message << action.first << ": " << action.second.count << " calls, "
+				<< Logger_Trace::toMicroSec(action.second.totalDuration) / 1000.0 << " ms total / "
+				<< Logger_Trace::toMicroSec(action.second.maxDuration) / 1000.0 << " ms max, histogram";
+			for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+				if (action.second.histogram[i]) {
+					message << " <" << Logger_Trace::formatBucket(i) << ": " << action.second.histogram[i];
+				}
+			}
+			this->logger->log(message.str(), Logger::IMPORTANT_EVENT);
+		}
+		if (droppedEvents) {
+			this->logger->log(std::to_string(droppedEvents) + " trace events dropped (limit reached)", Logger::IMPORTANT_EVENT);
+		}
+	}
+
+	private: void beginAction(std::string const& controller, std::string const& action) {
+		OpenAction openAction = {controller, action, std::chrono::steady_clock::now()};
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->actionStacks[this->getThreadId()].push_back(openAction);
+	}
+
+	private: void endAction() {
+		auto now = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto& stack = this->actionStacks[this->getThreadId()];
+		if (stack.empty()) {
+			return;
+		}
+		OpenAction openAction = stack.back();
+		stack.pop_back();
+
+		auto duration = now - openAction.begin;
+		this->addEvent('X', openAction.controller + "/" + openAction.action, openAction.controller, openAction.begin - this->startTime, duration);
+
+		ActionStatistics& actionStatistics = this->statistics[openAction.controller + "/" + openAction.action];
+		actionStatistics.count++;
+		actionStatistics.totalDuration += duration;
+		if (duration > actionStatistics.maxDuration) {
+			actionStatistics.maxDuration = duration;
+		}
+		size_t bucket = 0;
+		for (long long microSec = Logger_Trace::toMicroSec(duration); microSec > 0 && bucket < HISTOGRAM_BUCKETS - 1; microSec >>= 1) {
+			bucket++;
+		}
+		actionStatistics.histogram[bucket]++;
+	}
+
+	// must be called while the mutex is locked
+	private: void addEvent(char phase, std::string const& name, std::string const& category, std::chrono::steady_clock::duration begin, std::chrono::steady_clock::duration duration) {
+		if (this->events.size() >= this->maxEvents) {
+			this->droppedEvents++;
+			return;
+		}
+		Event event = {phase, name, category, begin, duration, this->getThreadId()};
+		this->events.push_back(event);
+	}
+
+	// small sequential ids are easier to read in the trace viewer - the first thread seen gets 1
+	// must be called while the mutex is locked
+	private: int getThreadId() {
+		auto id = this->threadIds.find(std::this_thread::get_id());
+		if (id == this->threadIds.end()) {
+			int newId = this->threadIds.size() + 1;
+			this->threadIds[std::this_thread::get_id()] = newId;
+			return newId;
+		}
+		return id->second;
+	}
+
+	private: static long long toMicroSec(std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+	}
+
+	private: static std::string formatBucket(size_t bucket) {
+		unsigned long long limit = 1ULL << bucket;
+		if (limit >= 1000000) {
+			return std::to_string(limit / 1000000) + "s";
+		} else if (limit >= 1000) {
+			return std::to_string(limit / 1000) + "ms";
+		}
+		return std::to_string(limit) + "µs";
+	}
+
+	private: static std::string escape(std::string const& str) {
+		std::string result;
+		for (char c : str) {
+			if (c == '"' || c == '\\') {
+				result += '\\';
+				result += c;
+			} else if (static_cast<unsigned char>(c) < 0x20) {
+				char buffer[7];
+				snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+				result += buffer;
+			} else {
+				result += c;
+			}
+		}
+		return result;
+	}
+};
+
+#endif /* TRACE_LOGGER_H_ */
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef MOUNT_H_
+#define MOUNT_H_
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <string>
+#include "Exception.hpp"
+#include "Helper.hpp"
+
+/**
+ * mounts using mount(2)/umount2(2) instead of running mount(8)/umount(8).
+ * Throws MountException/UMountException containing the errno description on failure.
+ * Some setups (loop devices, fuse and network filesystems, unknown options) still require
+ * mount(8) - mount() throws MountNeedsHelperException in these cases.
+ */
+class Mount {
+	public: static void mount(std::string const& device, std::string const& mountpoint, std::string const& fileSystem = "", std::string const& options = "") {
+		unsigned long flags = 0;
+		std::string data;
+		if (!Mount::parseOptions(options, flags, data)) {
+			throw MountNeedsHelperException("options '" + options + "' require mount(8)", __FILE__, __LINE__);
+		}
+
+		if (flags & MS_BIND) {
+			Mount::check(Mount::tryMount(device, mountpoint, "none", flags, data), device, mountpoint);
+			// the kernel ignores the other flags when creating a bind mount - they must be applied by remounting
+			if (flags & ~(MS_BIND | MS_REC)) {
+				int error = Mount::tryMount(device, mountpoint, "none", (flags & ~MS_REC) | MS_REMOUNT, data);
+				if (error != 0) {
+					umount2(mountpoint.c_str(), MNT_DETACH); // don't leave the bind mount without the requested options
+				}
+				Mount::check(error, device, mountpoint);
+			}
+			return;
+		}
+
+		std::string source = Mount::resolveDevice(device);
+		if (fileSystem != "" && fileSystem != "auto") {
+			Mount::check(Mount::tryMount(source, mountpoint, fileSystem, flags, data), device, mountpoint);
+			return;
+		}
+
+		// no type given - try the block device filesystems supported by the kernel like mount(8) does if it can't detect the type
+		struct stat sourceProperties;
+		if (stat(source.c_str(), &sourceProperties) != 0 || !S_ISBLK(sourceProperties.st_mode)) {
+			throw MountNeedsHelperException("cannot detect the filesystem of " + device, __FILE__, __LINE__);
+		}
+		for (auto const& type : Mount::getBlockDeviceFileSystems()) {
+			int error = Mount::tryMount(source, mountpoint, type, flags, data);
+			if (error != EINVAL && error != ENODEV) {
+				Mount::check(error, device, mountpoint); // wrong filesystem types give EINVAL - anything else is final
+				return;
+			}
+		}
+		throw MountException("cannot mount " + device + ": unknown filesystem", __FILE__, __LINE__);
+	}
+
+	public: static void umount(std::string const& mountpoint) {
+		if (umount2(mountpoint.c_str(), 0) != 0) {
+			throw UMountException("cannot umount " + mountpoint + ": " + strerror(errno), __FILE__, __LINE__);
+		}
+	}
+
+	// returns 0 or the errno value
+	private: static int tryMount(std::string const& source, std::string const& mountpoint, std::string const& type, unsigned long flags, std::string const& data) {
+		if (::mount(source.c_str(), mountpoint.c_str(), type.c_str(), flags, data == "" ? NULL : data.c_str()) != 0) {
+			return errno;
+		}
+		return 0;
+	}
+
+	private: static void check(int error, std::string const& device, std::string const& mountpoint) {
+		if (error != 0) {
+			throw MountException("cannot mount " + device + " on " + mountpoint + ": " + strerror(error), __FILE__, __LINE__);
+		}
+	}
+
+	// translates mount(8) options into flags and filesystem specific data - returns false if mount(8) is required
+	private: static bool parseOptions(std::string const& options, unsigned long& flags, std::string& data) {
+		static const struct {
+			char const* name;
+			unsigned long set, clear;
+		} knownOptions[] = {
+			{"defaults", 0, 0}, {"rw", 0, MS_RDONLY}, {"ro", MS_RDONLY, 0},
+			{"nosuid", MS_NOSUID, 0}, {"suid", 0, MS_NOSUID}, {"nodev", MS_NODEV, 0}, {"dev", 0, MS_NODEV},
+			{"noexec", MS_NOEXEC, 0}, {"exec", 0, MS_NOEXEC}, {"sync", MS_SYNCHRONOUS, 0}, {"async", 0, MS_SYNCHRONOUS},
+			{"dirsync", MS_DIRSYNC, 0}, {"noatime", MS_NOATIME, 0}, {"atime", 0, MS_NOATIME},
+			{"nodiratime", MS_NODIRATIME, 0}, {"diratime", 0, MS_NODIRATIME}, {"relatime", MS_RELATIME, 0},
+			{"norelatime", 0, MS_RELATIME}, {"strictatime", MS_STRICTATIME, 0}, {"bind", MS_BIND, 0}, {"rbind", MS_BIND | MS_REC, 0},
+			// only relevant for mount(8)/fstab handling
+			{"auto", 0, 0}, {"noauto", 0, 0}, {"user", 0, 0}, {"nouser", 0, 0}, {"users", 0, 0},
+			{"owner", 0, 0}, {"group", 0, 0}, {"nofail", 0, 0}, {"_netdev", 0, 0}
+		};
+
+		size_t optionBegin = 0;
+		while (optionBegin <= options.size()) {
+			size_t optionEnd = options.find(',', optionBegin);
+			if (optionEnd == std::string::npos) {
+				optionEnd = options.size();
+			}
+			std::string option = options.substr(optionBegin, optionEnd - optionBegin);
+			optionBegin = optionEnd + 1;
+			if (option == "") {
+				continue;
+			}
+			if (option == "loop" || option.substr(0, 5) == "loop=" || option.substr(0, 8) == "helper=") {
+				return false;
+			}
+			if (option.substr(0, 2) == "x-" || option.substr(0, 8) == "comment=") {
+				continue;
+			}
+			bool isKnown = false;
+			for (auto const& knownOption : knownOptions) {
+				if (option == knownOption.name) {
+					flags = (flags | knownOption.set) & ~knownOption.clear;
+					isKnown = true;
+					break;
+				}
+			}
+			if (!isKnown) {
+				data += (data == "" ? "" : ",") + option;
+			}
+		}
+		return true;
+	}
+
+	// resolves UUID=, LABEL=, PARTUUID= and PARTLABEL= using the udev symlinks
+	private: static std::string resolveDevice(std::string const& device) {
+		static const struct {
+			char const* tag;
+			char const* directory;
+		} tags[] = {
+			{"UUID=", "/dev/disk/by-uuid/"}, {"LABEL=", "/dev/disk/by-label/"},
+			{"PARTUUID=", "/dev/disk/by-partuuid/"}, {"PARTLABEL=", "/dev/disk/by-partlabel/"}
+		};
+		for (auto const& tag : tags) {
+			size_t tagLength = strlen(tag.tag);
+			if (device.compare(0, tagLength, tag.tag) == 0) {
+				std::string value = device.substr(tagLength);
+				if (value.size() >= 2 && (value[0] == '"' || value[0] == '\'') && value[value.size() - 1] == value[0]) {
+					value = value.substr(1, value.size() - 2);
+				}
+				char* resolvedPath = realpath((tag.directory + value).c_str(), NULL);
+				if (resolvedPath == NULL) {
+					throw MountNeedsHelperException("cannot resolve " + device, __FILE__, __LINE__);
+				}
+				std::string result = resolvedPath;
+				free(resolvedPath);
+				return result;
+			}
+		}
+		return device;
+	}
+
+	// filesystems listed in /proc/filesystems without "nodev" flag
+	private: static std::list<std::string> getBlockDeviceFileSystems() {
+		std::list<std::string> result;
+		std::ifstream fileSystems("/proc/filesystems");
+		std::string line;
+		while (std::getline(fileSystems, line)) {
+			if (line.substr(0, 5) != "nodev") {
+				std::string type = Helper::trim(line);
+				if (type != "") {
+					result.push_back(type);
+				}
+			}
+		}
+		return result;
+	}
+};
+
+#endif /* MOUNT_H_ */
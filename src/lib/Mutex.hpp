@@ -40,6 +40,14 @@ public:
 	virtual void lock() = 0;
 	virtual bool trylock() = 0;
 	virtual void unlock() = 0;
+
+	// like lock() and trylock() - the call site is used by instrumented implementations
+	virtual void lock(char const*, int) {
+		this->lock();
+	}
+	virtual bool trylock(char const*, int) {
+		return this->trylock();
+	}
 };
 
 class Mutex_Connection
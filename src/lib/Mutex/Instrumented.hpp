@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2010-2011 Daniel Richter <danielrichter2007@web.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ * 
+ * Additional permission under GNU GPL version 3 section 7
+ *
+ * If you modify this program, or any covered work, by linking or combining
+ * it with the OpenSSL library (or a modified version of that library),
+ * containing parts covered by the terms of the OpenSSL license, the licensors
+ * of this program grant you additional permission to convey the resulting work.
+ * Corresponding source for a non-source form of such a combination shall include
+ * the source code for the parts of the OpenSSL library used as well as that of
+ * the covered work.
+ */
+
+#ifndef INSTRUMENTEDMUTEX_H_
+#define INSTRUMENTEDMUTEX_H_
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "../Mutex.hpp"
+
+/**
+ * wraps another mutex and records per call site how often the lock was acquired,
+ * how long it took to get it and how long it was held
+ */
+class Mutex_Instrumented : public Mutex {
+	private: struct CallSiteStatistics {
+		unsigned long acquisitions, contendedAcquisitions, failedTrylocks;
+		std::chrono::steady_clock::duration totalWaitTime, maxWaitTime, totalHoldTime, maxHoldTime;
+
+		CallSiteStatistics()
+			: acquisitions(0), contendedAcquisitions(0), failedTrylocks(0),
+			  totalWaitTime(0), maxWaitTime(0), totalHoldTime(0), maxHoldTime(0)
+		{}
+	};
+
+	private: std::shared_ptr<Mutex> mutex;
+	private: std::string name;
+	private: std::map<std::string, CallSiteStatistics> statistics;
+	private: mutable std::mutex statisticsMutex;
+
+	// owner of the lock - only accessed while it's held
+	private: std::string holder;
+	private: std::chrono::steady_clock::time_point acquisitionTime;
+
+	public: Mutex_Instrumented(std::shared_ptr<Mutex> mutex, std::string const& name)
+		: mutex(mutex), name(name)
+	{}
+
+	public: void lock() {
+		this->lock("unknown", 0);
+	}
+
+	public: bool trylock() {
+		return this->trylock("unknown", 0);
+	}
+
+	public: void lock(char const* file, int line) {
+		auto begin = std::chrono::steady_clock::now();
+		bool contended = !this->mutex->trylock();
+		if (contended) {
+			this->mutex->lock();
+		}
+		auto acquired = std::chrono::steady_clock::now();
+		this->holder = Mutex_Instrumented::getCallSite(file, line);
+		this->acquisitionTime = acquired;
+
+		std::lock_guard<std::mutex> lock(this->statisticsMutex);
+		CallSiteStatistics& callSite = this->statistics[this->holder];
+		callSite.acquisitions++;
+		if (contended) {
+			callSite.contendedAcquisitions++;
+		}
+		callSite.totalWaitTime += acquired - begin;
+		callSite.maxWaitTime = std::max(callSite.maxWaitTime, acquired - begin);
+	}
+
+	public: bool trylock(char const* file, int line) {
+		std::string callSiteName = Mutex_Instrumented::getCallSite(file, line);
+		if (!this->mutex->trylock()) {
+			std::lock_guard<std::mutex> lock(this->statisticsMutex);
+			this->statistics[callSiteName].failedTrylocks++;
+			return false;
+		}
+		this->holder = callSiteName;
+		this->acquisitionTime = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(this->statisticsMutex);
+		this->statistics[callSiteName].acquisitions++;
+		return true;
+	}
+
+	public: void unlock() {
+		auto holdTime = std::chrono::steady_clock::now() - this->acquisitionTime;
+		std::string callSiteName = this->holder;
+		this->mutex->unlock();
+
+		std::lock_guard<std::mutex> lock(this->statisticsMutex);
+		CallSiteStatistics& callSite = this->statistics[callSiteName];
+		callSite.totalHoldTime += holdTime;
+		callSite.maxHoldTime = std::max(callSite.maxHoldTime, holdTime);
+	}
+
+	// logs the statistics of all call sites, ordered by total wait time
+	public: void dumpStatistics() const {
+		std::vector<std::pair<std::string, CallSiteStatistics>> callSites;
+		{
+			std::lock_guard<std::mutex> lock(this->statisticsMutex);
+			callSites.assign(this->statistics.begin(), this->statistics.end());
+		}
+		std::sort(callSites.begin(), callSites.end(), [] (std::pair<std::string, CallSiteStatistics> const& a, std::pair<std::string, CallSiteStatistics> const& b) {
+			return a.second.totalWaitTime > b.second.totalWaitTime;
+		});
+
+		this->log("lock statistics of " + this->name + " (" + std::to_string(callSites.size()) + " call sites)", Logger::IMPORTANT_EVENT);
+		for (auto& callSite : callSites) {
+			std::ostringstream message;
+			message << callSite.first << ": "
+				<< callSite.second.acquisitions << " acquired ("
+				<< callSite.second.contendedAcquisitions << " contended, "
+				<< callSite.second.failedTrylocks << " failed trylocks), wait "
+				<< Mutex_Instrumented::toMilliSec(callSite.second.totalWaitTime) << " ms total / "
+				<< Mutex_Instrumented::toMilliSec(callSite.second.maxWaitTime) << " ms max, hold "
+				<< Mutex_Instrumented::toMilliSec(callSite.second.totalHoldTime) << " ms total / "
+				<< Mutex_Instrumented::toMilliSec(callSite.second.maxHoldTime) << " ms max";
+			this->log(message.str(), Logger::IMPORTANT_EVENT);
+		}
+	}
+
+	private: static std::string getCallSite(char const* file, int line) {
+		char const* fileName = strrchr(file, '/');
+		return std::string(fileName ? fileName + 1 : file) + ":" + std::to_string(line);
+	}
+
+	private: static double toMilliSec(std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+};
+
+#endif /* INSTRUMENTEDMUTEX_H_ */
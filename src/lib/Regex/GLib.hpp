@@ -35,14 +35,78 @@
 #include <map>
 #include <glib.h>
 #include <iostream>
+#include <sstream>
 
 #include "../Exception.hpp"
 #include "../Regex.hpp"
 #include "../Helper.hpp"
+#include "../Trait/LoggerAware.hpp"
 
 class Regex_GLib :
-	public Regex
+	public Regex,
+	public Trait_LoggerAware
 {
+	// compiled patterns, shared between all threads (GRegex objects are immutable and thread safe)
+	private: std::map<std::pair<std::string, int>, GRegex*> cache;
+	private: Glib::Mutex cacheMutex;
+	private: bool optimize;
+	private: unsigned long cacheHitCount, compileCount;
+
+	// optimize: compile using G_REGEX_OPTIMIZE (JIT) - worthwhile because every pattern is compiled only once
+	public: Regex_GLib(bool optimize = true) : optimize(optimize), cacheHitCount(0), compileCount(0)
+	{}
+
+	public: ~Regex_GLib()
+	{
+		std::ostringstream stats;
+		stats << "regex cache: " << this->compileCount << " patterns compiled, " << this->cacheHitCount << " cache hits";
+		this->log(stats.str(), Logger::DEBUG);
+
+		for (auto& cacheItem : this->cache) {
+			g_regex_unref(cacheItem.second);
+		}
+	}
+
+	public: unsigned long getCacheHitCount()
+	{
+		Glib::Mutex::Lock lock(this->cacheMutex);
+		return this->cacheHitCount;
+	}
+
+	public: unsigned long getCompileCount()
+	{
+		Glib::Mutex::Lock lock(this->cacheMutex);
+		return this->compileCount;
+	}
+
+	// returns a new reference to the compiled pattern - must be released using g_regex_unref
+	private: GRegex* getCompiledPattern(std::string const& pattern, GRegexCompileFlags flags = GRegexCompileFlags(0))
+	{
+		if (this->optimize) {
+			flags = GRegexCompileFlags(flags | G_REGEX_OPTIMIZE);
+		}
+
+		Glib::Mutex::Lock lock(this->cacheMutex);
+		auto cacheItem = this->cache.find(std::make_pair(pattern, int(flags)));
+		if (cacheItem != this->cache.end()) {
+			this->cacheHitCount++;
+			return g_regex_ref(cacheItem->second);
+		}
+
+		GError* error = NULL;
+		GRegex* gr = g_regex_new(pattern.c_str(), flags, GRegexMatchFlags(0), &error);
+		if (gr == NULL) {
+			std::string message = error ? error->message : "unknown error";
+			if (error) {
+				g_error_free(error);
+			}
+			throw RegExNotMatchedException("invalid regex: " + pattern + " (" + message + ")", __FILE__, __LINE__);
+		}
+		this->compileCount++;
+		this->cache[std::make_pair(pattern, int(flags))] = gr;
+		return g_regex_ref(gr);
+	}
+
 	public: std::vector<std::string> match(
 		std::string const& pattern,
 		std::string const& str,
@@ -52,12 +116,15 @@ class Regex_GLib :
 	{
 		std::vector<std::string> result;
 		GMatchInfo* mi = NULL;
-		GRegex* gr = g_regex_new(pattern.c_str(), GRegexCompileFlags(0), GRegexMatchFlags(0), NULL);
+		GRegex* gr = this->getCompiledPattern(pattern);
 		std::string escapedStr = escapeCharacter == '\0' ? "" : Helper::str_replace_escape(str, escapeCharacter, replaceCharacter);
 		const gchar* matchStr = escapeCharacter == '\0' ? str.c_str() : escapedStr.c_str();
 		bool success = g_regex_match(gr, matchStr, GRegexMatchFlags(0), &mi);
-		if (!success)
+		if (!success) {
+			g_match_info_free(mi);
+			g_regex_unref(gr);
 			throw RegExNotMatchedException("RegEx doesn't match", __FILE__, __LINE__);
+		}
 
 		gint match_count = g_match_info_get_match_count(mi);
 		gint offset = 0;
@@ -83,14 +150,17 @@ class Regex_GLib :
 	{
 		std::string result = str;
 		GMatchInfo* mi = NULL;
-		GRegex* gr = g_regex_new(pattern.c_str(), GRegexCompileFlags(0), GRegexMatchFlags(0), NULL);
+		GRegex* gr = this->getCompiledPattern(pattern);
 
 		std::string escapedStr = escapeCharacter == '\0' ? "" : Helper::str_replace_escape(str, escapeCharacter, replaceCharacter);
 		const gchar* matchStr = escapeCharacter == '\0' ? str.c_str() : escapedStr.c_str();
 
 		bool success = g_regex_match(gr, matchStr, GRegexMatchFlags(0), &mi);
-		if (!success)
+		if (!success) {
+			g_match_info_free(mi);
+			g_regex_unref(gr);
 			throw RegExNotMatchedException("RegEx doesn't match", __FILE__, __LINE__);
+		}
 
 		gint match_count = g_match_info_get_match_count(mi);
 		gint offset = 0;
@@ -27,6 +27,11 @@
  */
 
 #include <iostream>
+#include <sstream>
+#include <set>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
 
 #include "../Bootstrap/View.hpp"
 #include "../Bootstrap/Application.hpp"
@@ -42,7 +47,9 @@
 #include "../Controller/Helper/RuleMover/Strategy/MoveRuleOutOfProxyOnToplevel.hpp"
 #include "../Controller/Helper/RuleMover/Strategy/MoveRuleIntoForeignSubmenu.hpp"
 #include "../Controller/Helper/RuleMover/Strategy/MoveForeignRuleFromSubmenuToToplevel.hpp"
+#include "../lib/Logger/Async.hpp"
 #include "../lib/Logger/Stream.hpp"
+#include "../lib/Logger/Trace.hpp"
 #include "../Mapper/EntryNameImpl.hpp"
 #include "../config.hpp"
 #include "../Controller/AboutController.hpp"
@@ -63,8 +70,15 @@ int main(int argc, char** argv){
 		return 0;
 	}
 
-	if (getuid() != 0 && (argc == 1 || argv[1] != std::string("no-fork"))) {
-		return system((std::string("xhost +SI:localuser:root; pkexec ") + argv[0] + (argc == 2 ? std::string(" ") + argv[1] : "") + " no-fork; xhost -SI:localuser:root").c_str());
+	// options may be combined in any order, e.g. "verbose trace"
+	std::set<std::string> options(argv + 1, argv + argc);
+
+	if (getuid() != 0 && options.find("no-fork") == options.end()) {
+		std::string forwardedOptions;
+		for (int i = 1; i < argc; i++) {
+			forwardedOptions += std::string(" ") + argv[i];
+		}
+		return system((std::string("xhost +SI:localuser:root; pkexec ") + argv[0] + forwardedOptions + " no-fork; xhost -SI:localuser:root").c_str());
 	}
 	setlocale(LC_ALL, "");
 	bindtextdomain("grub-customizer", LOCALEDIR);
@@ -72,12 +86,24 @@ int main(int argc, char** argv){
 
 	auto logger = std::make_shared<Logger_Stream>(std::cout);
 
-	Logger::getInstance() = logger;
+	// messages are written by a background thread, the stream is flushed once per batch
+	logger->setAutoFlush(false);
+	auto asyncLogger = std::make_shared<Logger_Async>(logger);
+
+	// "trace" records the action timing and writes a Chrome trace on exit
+	std::shared_ptr<Logger_Trace> traceLogger = nullptr;
+	if (options.find("trace") != options.end()) {
+		traceLogger = std::make_shared<Logger_Trace>(asyncLogger);
+		Logger::getInstance() = traceLogger;
+	} else {
+		Logger::getInstance() = asyncLogger;
+	}
 
 	try {
 		auto application          = std::make_shared<Bootstrap_Application>(argc, argv);
 		auto view                 = std::make_shared<Bootstrap_View>();
-		auto factory              = std::make_shared<Bootstrap_Factory>(application->applicationObject, logger);
+		bool lockStatistics       = options.find("lock-statistics") != options.end();
+		auto factory              = std::make_shared<Bootstrap_Factory>(application->applicationObject, Logger::getInstance(), lockStatistics);
 
 		auto settingsOnDisk       = factory->create<Model_SettingsManagerData>();
 		auto savedListCfg         = factory->create<Model_ListCfg>();
@@ -97,19 +123,17 @@ int main(int argc, char** argv){
 		mainController->setSettingsBuffer(settingsOnDisk);
 		mainController->setSavedListCfg(savedListCfg);
 
-		// configure logger
+		// configure logger - the background thread must not be writing while the level changes
+		asyncLogger->flush();
 		logger->setLogLevel(Logger_Stream::LOG_EVENT);
-		if (argc > 1) {
-			std::string logParam = argv[1];
-			if (logParam == "debug") {
-				logger->setLogLevel(Logger_Stream::LOG_DEBUG_ONLY);
-			} else if (logParam == "log-important") {
-				logger->setLogLevel(Logger_Stream::LOG_IMPORTANT);
-			} else if (logParam == "quiet") {
-				logger->setLogLevel(Logger_Stream::LOG_NOTHING);
-			} else if (logParam == "verbose") {
-				logger->setLogLevel(Logger_Stream::LOG_VERBOSE);
-			}
+		if (options.find("debug") != options.end()) {
+			logger->setLogLevel(Logger_Stream::LOG_DEBUG_ONLY);
+		} else if (options.find("log-important") != options.end()) {
+			logger->setLogLevel(Logger_Stream::LOG_IMPORTANT);
+		} else if (options.find("quiet") != options.end()) {
+			logger->setLogLevel(Logger_Stream::LOG_NOTHING);
+		} else if (options.find("verbose") != options.end()) {
+			logger->setLogLevel(Logger_Stream::LOG_VERBOSE);
 		}
 
 		factory->contentParserFactory->registerParser(factory->create<ContentParser_Linux>(), gettext("Linux"));
@@ -130,8 +154,31 @@ int main(int argc, char** argv){
 		errorController->setApplicationStarted(true);
 
 		application->applicationObject->run();
+
+		if (traceLogger) {
+			// mkstemps creates a new file (O_EXCL, mode 0600) - existing files and symlinks aren't followed
+			std::string suffix = ".trace.json";
+			std::string traceFileName = "/tmp/grub-customizer-XXXXXX" + suffix;
+			int traceFile = mkstemps(&traceFileName[0], suffix.size());
+			traceLogger->dumpStatistics();
+			if (traceFile != -1) {
+				std::ostringstream trace;
+				traceLogger->writeChromeTrace(trace);
+				std::string traceData = trace.str();
+				bool written = write(traceFile, traceData.data(), traceData.size()) == ssize_t(traceData.size());
+				close(traceFile);
+				if (written) {
+					Logger::getInstance()->log("trace written to " + traceFileName, Logger::IMPORTANT_EVENT);
+				} else {
+					Logger::getInstance()->log("failed writing the trace to " + traceFileName, Logger::ERROR);
+				}
+			} else {
+				Logger::getInstance()->log("cannot create the trace file", Logger::ERROR);
+			}
+		}
+		Logger::getInstance()->flush();
 	} catch (Exception const& e) {
-		logger->log(e, Logger::ERROR);
+		Logger::getInstance()->log(e, Logger::ERROR);
 		return 1;
 	}
 }
@@ -31,19 +31,31 @@
 #include <memory>
 #include "../Model/ListCfg.hpp" // multi
 #include "../Model/Proxy.hpp"
+#include "../Model/ProxyStreamFilter.hpp"
 #include "../Model/Rule.hpp"
 #include "../Model/Script.hpp"
 
 int main(int argc, char** argv){
-	if (argc == 2) {
+	if (argc == 3 && std::string(argv[2]) == "stream") {
+		auto proxy = std::make_shared<Model_Proxy>();
+		proxy->importRuleString(argv[1], "");
+		if (Model_ProxyStreamFilter::isApplicable(proxy->rules)) {
+			LineReader input(stdin);
+			Model_ProxyStreamFilter(proxy->rules).run(input, std::cout);
+			return 0;
+		}
+		// rules from an incompatible version - use the single script mode
+	}
+	if (argc == 2 || (argc == 3 && std::string(argv[2]) == "stream")) {
 		auto script = std::make_shared<Model_Script>("noname", "");
 		std::shared_ptr<Model_Entry> newEntry;
 		std::string plaintextBuffer;
-		while (*(newEntry = std::make_shared<Model_Entry>(stdin, Model_Entry_Row(), nullptr, &plaintextBuffer))) {
-			script->entries().push_back(newEntry);
+		LineReader input(stdin);
+		while (*(newEntry = std::make_shared<Model_Entry>(input, Model_Entry_Row(), nullptr, &plaintextBuffer))) {
+			script->addEntry(newEntry);
 		}
 		if (plaintextBuffer.size()) {
-			script->entries().push_front(std::make_shared<Model_Entry>("#text", "", plaintextBuffer, Model_Entry::PLAINTEXT));
+			script->addEntry(std::make_shared<Model_Entry>("#text", "", plaintextBuffer, Model_Entry::PLAINTEXT), true);
 		}
 
 		auto proxy = std::make_shared<Model_Proxy>();